@@ -27,14 +27,20 @@
 #ifndef __calculator_H__
 #define __calculator_H__
 
-// function calculates new values from the given water level in millimeters
-void ICACHE_FLASH_ATTR calculator_calculateNewValues(float waterLevel);
-// returns the last calculated wasser content in liters
-float ICACHE_FLASH_ATTR calculator_getLiter();
-// returns the last calculated water level in centimeters
-float ICACHE_FLASH_ATTR calculator_getCentimeter();
-// returns the last calculated water content in percent
-float ICACHE_FLASH_ATTR calculator_getPercent();
+// the water content in liters and percent if it can't be calculated from the cistern parameters; posted instead of an empty cistern
+#define CALCULATOR_CONTENT_INVALID (-1)
+
+// function calculates new values for the cistern of the ultrasonic sensor channel from the given water level in 1/DISTANCE_UNITS_PER_MM mm
+void ICACHE_FLASH_ATTR calculator_calculateNewValues(unsigned char channel, sint32 fixedPointWaterLevel);
+// returns TRUE if the water content of the cistern of the ultrasonic sensor channel could be calculated;
+// otherwise the content in liters and percent is CALCULATOR_CONTENT_INVALID
+unsigned char ICACHE_FLASH_ATTR calculator_isContentCalculated(unsigned char channel);
+// returns the last calculated wasser content in liters of the cistern of the ultrasonic sensor channel
+float ICACHE_FLASH_ATTR calculator_getLiter(unsigned char channel);
+// returns the last calculated water level in centimeters of the cistern of the ultrasonic sensor channel
+float ICACHE_FLASH_ATTR calculator_getCentimeter(unsigned char channel);
+// returns the last calculated water content in percent of the cistern of the ultrasonic sensor channel
+float ICACHE_FLASH_ATTR calculator_getPercent(unsigned char channel);
 
 #endif // __calculator_H__
  
@@ -45,6 +45,8 @@ unsigned short ICACHE_FLASH_ATTR configuration_getDeepSleepPeriod();
 unsigned short ICACHE_FLASH_ATTR configuration_getMinDifferenceToPost();
 // after this max count of deep sleep cycles also an unchanged measurement will be postet
 unsigned short ICACHE_FLASH_ATTR configuration_getMaxDataAgeToPost();
+// measurement period in milliseconds of the continuous mode for mains-powered installations; 0 = deep sleep mode
+unsigned short ICACHE_FLASH_ATTR configuration_getContinuousPeriod();
 // if TRUE the data should be posted to a Thingspeak server
 unsigned char ICACHE_FLASH_ATTR configuration_shouldPostToThingspeak();
 // Thingspeak server URL
@@ -65,11 +67,14 @@ char* ICACHE_FLASH_ATTR configuration_getMqttPassword();
 char* ICACHE_FLASH_ATTR configuration_getMqttClientName();
 // MQTT topic
 char* ICACHE_FLASH_ATTR configuration_getMqttTopic();
-// returns the cistern parameters in the parameters
-void ICACHE_FLASH_ATTR configuration_getCisternParameters(unsigned char *cisternType, unsigned int *cisternRadius,
+// returns the parameters of the cistern of the ultrasonic sensor channel in the parameters
+void ICACHE_FLASH_ATTR configuration_getCisternParameters(unsigned char channel, unsigned char *cisternType, unsigned int *cisternRadius,
 	unsigned int *cisternLength, unsigned int *distanceEmpty, unsigned int *litersFull);
-// gets the distance in millimeters water to ultrasonic sensor if the cistern is empty
-unsigned int ICACHE_FLASH_ATTR configuration_getDistanceEmpty();
+// returns the additional dimensions in millimeters of the sphere, rectangular, truncated cone and domed cylinder cisterns of the ultrasonic sensor channel
+void ICACHE_FLASH_ATTR configuration_getCisternShape(unsigned char channel, unsigned int *cisternWidth, unsigned int *cisternHeight,
+	unsigned int *cisternTopRadius, unsigned int *cisternDomeDepth);
+// gets the distance in millimeters water to ultrasonic sensor of the channel if the cistern is empty
+unsigned int ICACHE_FLASH_ATTR configuration_getDistanceEmpty(unsigned char channel);
 // return the log type: 0 = logging disabled; 1 = logging will be sent using insecure TCP connection; 2 = logging will be sent using secure TCP connection
 unsigned char ICACHE_FLASH_ATTR configuration_getLogType();
 // host name or IPv4addres: if we have a wifi connection we send the log to this host
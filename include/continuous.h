@@ -0,0 +1,34 @@
+/*
+* ----------------------------------------------------------------------------
+* The MIT License (MIT)
+*
+* Copyright (c) 2016 - Matthias Jentsch
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+* ----------------------------------------------------------------------------
+*/
+
+#ifndef __continuous_H__
+#define __continuous_H__
+
+// starts the continuous mode for mains-powered installations; the module doesn't sleep, measures every ContinuousPeriod milliseconds
+// and publishes the water levels over an open MQTT connection if they have changed or are too old
+void ICACHE_FLASH_ATTR continuous_start();
+
+#endif // __continuous_H__
\ No newline at end of file
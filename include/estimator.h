@@ -0,0 +1,49 @@
+/*
+* ----------------------------------------------------------------------------
+* The MIT License (MIT)
+*
+* Copyright (c) 2016 - Matthias Jentsch
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+* ----------------------------------------------------------------------------
+*/
+
+#ifndef __estimator_H__
+#define __estimator_H__
+
+// estimator types
+// drops the min and the max value and calculates the mean of the remaining values
+#define ESTIMATOR_TRIMMED_MEAN 0
+// median of the values
+#define ESTIMATOR_MEDIAN 1
+// mean of the values that are not identified as outliers by a Hampel filter (median +/- 3 scaled MAD)
+#define ESTIMATOR_HAMPEL_MEAN 2
+// mean of the values between the first and the third quartile
+#define ESTIMATOR_INTERQUARTILE_MEAN 3
+
+// max count of values the estimators can handle; the values are copied into a buffer of this size on the stack
+#define ESTIMATOR_MAX_VALUES 16
+
+// estimates the central value of the given values; values <= 0 are invalid and will be ignored
+// pEstimate receives the estimated value and pDispersion the median absolute deviation of the valid values
+// returns the count of valid values; if zero then pEstimate and pDispersion are set to 0
+unsigned char ICACHE_FLASH_ATTR estimator_estimate(unsigned char estimatorType, const sint32 *pValues, unsigned char count,
+	sint32 *pEstimate, sint32 *pDispersion);
+
+#endif // __estimator_H__
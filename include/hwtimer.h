@@ -0,0 +1,47 @@
+/*
+* ----------------------------------------------------------------------------
+* The MIT License (MIT)
+*
+* Copyright (c) 2016 - Matthias Jentsch
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+* ----------------------------------------------------------------------------
+*/
+
+#ifndef __hwtimer_H__
+#define __hwtimer_H__
+
+// the FRC1 hardware timer runs with 80 MHz / 16 = 5 ticks per microsecond
+#define HWTIMER_TICKS_PER_US 5
+// max timespan of the hardware timer in microseconds (23 bit counter)
+#define HWTIMER_MAX_US (0x7FFFFF / HWTIMER_TICKS_PER_US)
+// min timespan of the hardware timer in microseconds; shorter timespans may elapse before the interrupt is enabled
+#define HWTIMER_MIN_US 10
+
+// the callback is called in interrupt context; so it must be placed in IRAM (no ICACHE_FLASH_ATTR)
+typedef void hwtimer_callback();
+
+// initializes the FRC1 hardware timer; the callback is called after the timespan given to hwtimer_arm is elapsed
+void ICACHE_FLASH_ATTR hwtimer_init(hwtimer_callback *pCallback);
+// starts the hardware timer; the callback is called once after the given microseconds (HWTIMER_MIN_US to HWTIMER_MAX_US); may be called in interrupt context
+void hwtimer_arm(uint32 us);
+// stops the hardware timer; may be called in interrupt context
+void hwtimer_disarm();
+
+#endif // __hwtimer_H__
\ No newline at end of file
@@ -33,8 +33,15 @@
 #define TRIGGER_GPIO 12
 // The ultrasonic echo input is connected to GPIO13
 #define ECHO_GPIO 13
+// The trigger pin of the second ultrasonic sensor is connected to GPIO4; only used if ULTRASONIC_CHANNEL_COUNT is 2
+#define TRIGGER_GPIO_2 4
+// The echo input of the second ultrasonic sensor is connected to GPIO5; only used if ULTRASONIC_CHANNEL_COUNT is 2
+#define ECHO_GPIO_2 5
 // The general purpose LED is attached to GPIO14
 #define LED_GPIO 14
+// The supply of the ultrasonic sensors is switched by a P-channel MOSFET at GPIO2; low switches the sensors on
+// GPIO2 must be high while booting; so the sensors are off after a reset; only used if SENSOR_POWER_GATING is defined
+#define SENSOR_POWER_GPIO 2
 
 // initalize the hardware
 void ICACHE_FLASH_ATTR io_init();
@@ -46,5 +53,7 @@ void ICACHE_FLASH_ATTR io_ledSet(unsigned char state);
 void ICACHE_FLASH_ATTR io_ledPulse(unsigned short pulsePeriodInMs);
 // function start the led blink mode
 void ICACHE_FLASH_ATTR io_ledBlink(unsigned short onPeriodInMs, unsigned short offPeriodInMs);
+// function switches the supply of the ultrasonic sensors on or off; see SENSOR_POWER_GATING
+void ICACHE_FLASH_ATTR io_sensorPower(unsigned char state);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,50 @@
+/*
+* ----------------------------------------------------------------------------
+* The MIT License (MIT)
+*
+* Copyright (c) 2016 - Matthias Jentsch
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+* ----------------------------------------------------------------------------
+*/
+
+#ifndef __levelfilter_H__
+#define __levelfilter_H__
+
+// state of the level filter; the state is stored in RTC memory and updated once per measurement
+typedef struct
+{
+	sint32 level;	// filtered water level in 1/DISTANCE_UNITS_PER_MM mm
+	sint32 rate;	// filtered rate of change of the water level in 1/DISTANCE_UNITS_PER_MM mm per hour
+	uint32 variance;	// variance of the filtered water level in (1/DISTANCE_UNITS_PER_MM mm)^2; 0 = filter not initialized
+	unsigned short missCount;	// count of the consecutive measurements outside the gate of the filter
+	unsigned short alignment;	// aligned to 4-byte boundary
+} LevelFilterState;
+
+// resets the filter state; the next measurement initializes the filter
+void ICACHE_FLASH_ATTR levelfilter_reset(LevelFilterState *pState);
+// updates the filter state with a new measurement and returns the filtered water level
+// pMeasuredLevel: the measured water level in 1/DISTANCE_UNITS_PER_MM mm
+// pDispersion: the dispersion (median absolute deviation) of the measurement in 1/DISTANCE_UNITS_PER_MM mm
+// pElapsedSeconds: seconds since the last update
+sint32 ICACHE_FLASH_ATTR levelfilter_update(LevelFilterState *pState, sint32 pMeasuredLevel, sint32 pDispersion, uint32 pElapsedSeconds);
+// delivers TRUE if the filter is initialized and its variance is small enough that a measurement with only a few shots is sufficient
+unsigned char ICACHE_FLASH_ATTR levelfilter_isSettled(const LevelFilterState *pState);
+
+#endif // __levelfilter_H__
@@ -0,0 +1,66 @@
+/*
+* ----------------------------------------------------------------------------
+* The MIT License (MIT)
+*
+* Copyright (c) 2016 - Matthias Jentsch
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+* ----------------------------------------------------------------------------
+*/
+
+#ifndef __metrics_H__
+#define __metrics_H__
+
+// the consumption is summed up in hourly buckets over this count of hours
+#define METRICS_HOURS 24
+// value of metrics_getTimeToEmpty if the cistern isn't emptied
+#define METRICS_NOT_EMPTYING (-1)
+
+// state of the derived metrics of one cistern; the state is stored in RTC memory and updated once per measurement
+typedef struct
+{
+	sint32 referenceLevel;	// water level of the last significant change in 1/DISTANCE_UNITS_PER_MM mm
+	sint32 referenceContent;	// water content of the last significant change in deciliters
+	sint32 rate;	// smoothed rate of change of the water content in deciliters per hour; positive = inflow
+	uint32 secondsSinceReference;	// seconds since the last significant change
+	uint16 consumption[METRICS_HOURS];	// outflow in liters per hour; consumption[hourIndex] is the current hour
+	uint16 consumptionRemainder;	// outflow in deciliters that is not yet summed up to a full liter; carried into the next hour
+	uint16 secondsInHour;	// elapsed seconds of the current hour
+	uint8 hourIndex;	// the bucket of the current hour
+	uint8 hoursCount;	// count of the completed hours since the reset; max METRICS_HOURS
+	uint8 isInitialized;	// FALSE until the first update
+	uint8 alignment;	// aligned to 4-byte boundary
+} MetricsState;
+
+// resets the metrics state; the next measurement initializes it
+void ICACHE_FLASH_ATTR metrics_reset(MetricsState *pState);
+// updates the metrics with a new measurement; changes of the water level smaller than METRICS_DEADBAND_MM are ignored
+// pWaterLevel: the (filtered) water level in 1/DISTANCE_UNITS_PER_MM mm
+// pContent: the water content at this level in deciliters
+// pElapsedSeconds: seconds since the last update
+void ICACHE_FLASH_ATTR metrics_update(MetricsState *pState, sint32 pWaterLevel, sint32 pContent, uint32 pElapsedSeconds);
+// gets the rate of change of the water content in deciliters per hour; positive = inflow; negative = outflow
+sint32 ICACHE_FLASH_ATTR metrics_getRate(const MetricsState *pState);
+// gets the outflow of the last METRICS_HOURS hours in deciliters
+uint32 ICACHE_FLASH_ATTR metrics_getConsumption(const MetricsState *pState);
+// gets the projected time in minutes until the cistern is empty; METRICS_NOT_EMPTYING if there is no outflow
+// the greater of the current outflow and the average outflow of the last METRICS_HOURS hours is projected
+sint32 ICACHE_FLASH_ATTR metrics_getTimeToEmpty(const MetricsState *pState);
+
+#endif // __metrics_H__
\ No newline at end of file
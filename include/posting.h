@@ -33,8 +33,19 @@ void ICACHE_FLASH_ATTR posting_start(System_Event_t *evt);
 void ICACHE_FLASH_ATTR posting_startTimeoutTimer();
 // called after the ultrasonic measurement is finished; checks if the date should pe posted
 void ICACHE_FLASH_ATTR posting_checkIfPostNeeded();
+// starts the measurement of the posting wake up; runs while the module connects to the access point; see MEASURE_WHILE_POSTING
+void ICACHE_FLASH_ATTR posting_startMeasurement();
 // initialize MQTT part
 void ICACHE_FLASH_ATTR posting_initializeMqtt();
+// initialize MQTT part for the continuous mode; the connection is kept open and reconnected if it's lost
+void ICACHE_FLASH_ATTR posting_initializeContinuousMqtt();
+// connects to the MQTT broker; in the continuous mode the connection is kept open
+void ICACHE_FLASH_ATTR posting_connectMqtt();
+// publishes the water levels of all cisterns in 1/DISTANCE_UNITS_PER_MM mm over the open MQTT connection of the continuous mode
+// returns FALSE if the MQTT client isn't connected
+unsigned char ICACHE_FLASH_ATTR posting_publishContinuous(const sint32 *pWaterLevels);
+// connects to the access point of the configuration; the event handler is called after the connection is established
+void ICACHE_FLASH_ATTR posting_connectWifi(wifi_event_handler_cb_t pEventHandler);
 
 #endif // __posting_H__
 
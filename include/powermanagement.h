@@ -27,6 +27,20 @@
 #ifndef __powermanagement_H__
 #define __powermanagement_H__
 
+#ifdef WIFI_FAST_CONNECT
+// the parameters of the last connection to the access point; kept in RTC memory for the fast reconnect of the next posting wake up
+typedef struct
+{
+	uint8 bssid[6];	// BSSID of the access point
+	uint8 channel;	// WiFi channel of the access point; 0 = no parameters saved
+	uint8 useCount;	// count of the fast reconnects with these parameters; see WIFI_FAST_CONNECT_MAX_USES
+	uint32 ip;	// the IPv4 addresses as in ip_addr
+	uint32 netmask;
+	uint32 gateway;
+	uint32 dns;
+} WifiConnectionCache;
+#endif
+
 // delivers TRUE if the data was initialized and the module should go to one deep sleep cycle for disabling the modem
 unsigned char ICACHE_FLASH_ATTR powermanagement_readOrInitData();
 // delivers TRUE if the program should enter the configuration mode
@@ -38,14 +52,65 @@ unsigned char ICACHE_FLASH_ATTR powermanagement_shouldPostMeasurement();
 // delivers TRUE TRUE if the program should post the log data to the internet; and don't do a water level measurement
 unsigned char ICACHE_FLASH_ATTR powermanagement_shouldPostLog();
 // checks the measurement
-// pCurrentWaterLevel: the measured water level in mm
-unsigned char ICACHE_FLASH_ATTR powermanagement_checkCurrentMeasurement(float pCurrentWaterLevel);
-// gets the measured water level in mm; that value that was saved in RTC memory
-float ICACHE_FLASH_ATTR powermanagement_getLastMeasurement();
+// pCurrentWaterLevels: the measured water levels of all ultrasonic sensor channels in 1/DISTANCE_UNITS_PER_MM mm
+unsigned char ICACHE_FLASH_ATTR powermanagement_checkCurrentMeasurement(const sint32 *pCurrentWaterLevels);
+#ifdef BATCH_POSTING
+// gets the count of the measurements in the batch that are not posted yet; every checked measurement is added to the batch
+unsigned char ICACHE_FLASH_ATTR powermanagement_getBatchPointCount();
+// gets one measurement of the batch; index 0 is the oldest
+// pSecondsSincePrevious: seconds since the measurement before
+// pWaterLevel: the water level of the ultrasonic sensor channel in 1/DISTANCE_UNITS_PER_MM mm
+void ICACHE_FLASH_ATTR powermanagement_getBatchPoint(unsigned char pIndex, unsigned char pChannel, unsigned int *pSecondsSincePrevious, sint32 *pWaterLevel);
+// adds the water levels of all channels to the batch; checked measurements are added by powermanagement_checkCurrentMeasurement
+// pWaterLevels: the water levels of all ultrasonic sensor channels in 1/DISTANCE_UNITS_PER_MM mm
+void ICACHE_FLASH_ATTR powermanagement_addBatchPoint(const sint32 *pWaterLevels);
+// gets the seconds since the newest measurement was added to the batch; including the awake time of this wake up
+unsigned int ICACHE_FLASH_ATTR powermanagement_getSecondsSinceBatchPoint();
+// clears the batch after it is published; the batch is kept until it's published even if the values are posted otherwise
+void ICACHE_FLASH_ATTR powermanagement_batchPosted();
+#endif
+// updates the level filter of the ultrasonic sensor channel with the current measurement and returns the filtered water level
+// pChannel: the ultrasonic sensor channel
+// pCurrentWaterLevel: the measured water level in 1/DISTANCE_UNITS_PER_MM mm
+// pDispersion: the dispersion of the measured values in 1/DISTANCE_UNITS_PER_MM mm
+sint32 ICACHE_FLASH_ATTR powermanagement_filterMeasurement(unsigned char pChannel, sint32 pCurrentWaterLevel, sint32 pDispersion);
+// gets the rate of change of the filtered water level of the ultrasonic sensor channel in 1/DISTANCE_UNITS_PER_MM mm per hour
+sint32 ICACHE_FLASH_ATTR powermanagement_getLevelRate(unsigned char pChannel);
+#ifdef DERIVED_METRICS
+// updates the derived metrics of the ultrasonic sensor channel with the current measurement; see metrics.h
+// pWaterLevel: the water level in 1/DISTANCE_UNITS_PER_MM mm
+// pContent: the water content at this level in deciliters
+void ICACHE_FLASH_ATTR powermanagement_updateMetrics(unsigned char pChannel, sint32 pWaterLevel, sint32 pContent);
+// gets the flow rate of the cistern of the ultrasonic sensor channel in deciliters per hour; positive = inflow; negative = outflow
+sint32 ICACHE_FLASH_ATTR powermanagement_getFlowRate(unsigned char pChannel);
+// gets the consumption of the cistern of the ultrasonic sensor channel in the last METRICS_HOURS hours in deciliters
+uint32 ICACHE_FLASH_ATTR powermanagement_getConsumption(unsigned char pChannel);
+// gets the projected time in minutes until the cistern of the ultrasonic sensor channel is empty; METRICS_NOT_EMPTYING if there is no outflow
+sint32 ICACHE_FLASH_ATTR powermanagement_getTimeToEmpty(unsigned char pChannel);
+#endif
+// delivers TRUE if the level filters of all channels are settled and a measurement with only a few shots is sufficient
+unsigned char ICACHE_FLASH_ATTR powermanagement_isLevelFilterSettled();
+// stores the quality of the last measurement cycle of the ultrasonic sensor channel into RTC memory
+void ICACHE_FLASH_ATTR powermanagement_setMeasurementQuality(unsigned char pChannel, const MeasurementQuality *pQuality);
+// gets the quality of the last measurement cycle of the ultrasonic sensor channel; that value that was saved in RTC memory
+const MeasurementQuality* ICACHE_FLASH_ATTR powermanagement_getMeasurementQuality(unsigned char pChannel);
+// delivers TRUE if the signal of the last measurement cycle of all channels was clean:
+// no lost shot, no shot out of range and the jitter not greater than CLEAN_SIGNAL_MAX_JITTER_MM
+unsigned char ICACHE_FLASH_ATTR powermanagement_isSignalClean();
+// gets the measured water level of the ultrasonic sensor channel in 1/DISTANCE_UNITS_PER_MM mm; that value that was saved in RTC memory
+sint32 ICACHE_FLASH_ATTR powermanagement_getLastMeasurement(unsigned char pChannel);
+// replaces the saved water level of the ultrasonic sensor channel in 1/DISTANCE_UNITS_PER_MM mm with a fresh measurement
+void ICACHE_FLASH_ATTR powermanagement_setLastMeasurement(unsigned char pChannel, sint32 pWaterLevel);
+#ifdef WIFI_FAST_CONNECT
+// gets the parameters of the last connection to the access point; that values that were saved in RTC memory
+WifiConnectionCache* ICACHE_FLASH_ATTR powermanagement_getWifiConnectionCache();
+#endif
 // set the flags to signal that the measurement is posted successfully to the internet
 void ICACHE_FLASH_ATTR powermanagement_measurementPosted();
 // set the flags for measurement not posted => typ to post again after the next measurement
 void ICACHE_FLASH_ATTR powermanagement_postingCanceled();
+// the continuous mode needs the modem; goes to one deep sleep cycle for activating the modem
+void ICACHE_FLASH_ATTR powermanagement_activateModem();
 // preparation for entering the configuration mode
 void ICACHE_FLASH_ATTR powermanagement_enterConfigurationMode();
 // preparation for leaving the configuration mode
@@ -55,6 +120,9 @@ void ICACHE_FLASH_ATTR powermanagement_deepSleep();
 // points to the next log byte; relative to the beginning of the log; starts with 0
 unsigned int ICACHE_FLASH_ATTR powermanagement_getNextLogBytePointer();
 void ICACHE_FLASH_ATTR powermanagement_setNextLogBytePointer(unsigned int nextLogBytePointer);
+// the tuned settle time of the ultrasonic sensors after switching them on in milliseconds; 0 = not tuned yet; see SENSOR_POWER_GATING
+unsigned short ICACHE_FLASH_ATTR powermanagement_getSensorSettleTime();
+void ICACHE_FLASH_ATTR powermanagement_setSensorSettleTime(unsigned short sensorSettleTime);
 // call this to signal that the program should post the log data to the internet; and don't do a water level measurement
 void ICACHE_FLASH_ATTR powermanagement_setShouldPostLog(unsigned char shouldPostLog);
 
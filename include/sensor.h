@@ -0,0 +1,67 @@
+/*
+* ----------------------------------------------------------------------------
+* The MIT License (MIT)
+*
+* Copyright (c) 2016 - Matthias Jentsch
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+* ----------------------------------------------------------------------------
+*/
+
+#ifndef __sensor_H__
+#define __sensor_H__
+
+// ultrasonic sensor types; select one with ULTRASONIC_SENSOR in user_config.h
+// the drivers of the other sensor types are not compiled in
+// HC-SR04: the echo pin is high as long as the ultrasonic burst is on the way
+#define SENSOR_HCSR04 0
+// JSN-SR04T (waterproof): same interface as the HC-SR04 but with a longer trigger pulse, a wider blind zone and a longer measuring cycle
+#define SENSOR_JSNSR04T 1
+// sensors that send the (filtered) distance in millimeters as UART frame (A02YYUW and similar); see uartsensor.h
+#define SENSOR_UART 2
+
+#if ULTRASONIC_SENSOR == SENSOR_HCSR04
+// Length of the trigger pulse in microseconds
+#define SENSOR_TRIGGER_PULSE_US 15
+// if no echo was received the echo pin stays high for about 38 ms; so the next shot of the channel is fired after this timespan in milliseconds
+#define SENSOR_NO_ECHO_SILENCE_TIMESPAN_MS 40
+// min timespan between two shots of the channel in milliseconds
+#define SENSOR_MIN_SILENCE_TIMESPAN_MS 10
+// distances below this value in millimeters are in the blind zone of the sensor and invalid
+#define SENSOR_MIN_DISTANCE_MM 20
+#elif ULTRASONIC_SENSOR == SENSOR_JSNSR04T
+// Length of the trigger pulse in microseconds; some JSN-SR04T don't fire with the 10 microseconds of the datasheet
+#define SENSOR_TRIGGER_PULSE_US 20
+// if no echo was received the echo pin stays high for about 60 ms
+#define SENSOR_NO_ECHO_SILENCE_TIMESPAN_MS 70
+// the datasheet demands a measuring cycle of at least 50 ms
+#define SENSOR_MIN_SILENCE_TIMESPAN_MS 50
+// the blind zone is 25 cm
+#define SENSOR_MIN_DISTANCE_MM 250
+#elif ULTRASONIC_SENSOR == SENSOR_UART
+// the A02YYUW measures down to 3 cm
+#define SENSOR_MIN_DISTANCE_MM 30
+#else
+#error "ULTRASONIC_SENSOR must be SENSOR_HCSR04, SENSOR_JSNSR04T or SENSOR_UART"
+#endif
+
+// TRUE if the sensor reports the distance as length of the echo pulse
+#define SENSOR_HAS_ECHO_PULSE (ULTRASONIC_SENSOR != SENSOR_UART)
+
+#endif // __sensor_H__
\ No newline at end of file
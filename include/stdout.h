@@ -13,5 +13,7 @@
 #define STDOUT_H
 
 void ICACHE_FLASH_ATTR stdout_init();
+// enables or disables the output to UART0; disabled while UART0 is swapped to a sensor; the log gets the output anyway
+void ICACHE_FLASH_ATTR stdout_setUartEnabled(unsigned char isEnabled);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,52 @@
+/*
+* ----------------------------------------------------------------------------
+* The MIT License (MIT)
+*
+* Copyright (c) 2016 - Matthias Jentsch
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+* ----------------------------------------------------------------------------
+*/
+
+#ifndef __strappingtable_H__
+#define __strappingtable_H__
+
+// max count of (level, content) points of the strapping table of one cistern
+#define STRAPPING_TABLE_MAX_POINTS 256
+
+// sets one point of the received strapping table of the cistern of the channel; the index 0 starts a new table
+// the points must be set in order with rising levels and not falling contents; returns FALSE if the point is not valid
+// pLevel: the water level in millimeters; pMilliliters: the water content at this level
+unsigned char ICACHE_FLASH_ATTR strappingtable_setPoint(unsigned char pChannel, unsigned short pIndex, unsigned short pLevel, uint32 pMilliliters);
+// returns TRUE if a strapping table was received in the configuration mode
+unsigned char ICACHE_FLASH_ATTR strappingtable_isReceived();
+// saves the received strapping tables into flash; the saved tables of the other channels are kept
+// the sector is only erased if the received tables differ from the saved ones
+void ICACHE_FLASH_ATTR strappingtable_save();
+// gets the count of points of the strapping table of the cistern of the channel; the received table if there is one, otherwise the saved one
+unsigned short ICACHE_FLASH_ATTR strappingtable_getPointCount(unsigned char pChannel);
+// gets one point of the strapping table of the cistern of the channel; the received table if there is one, otherwise the saved one
+unsigned char ICACHE_FLASH_ATTR strappingtable_getPoint(unsigned char pChannel, unsigned short pIndex, unsigned short *pLevel, uint32 *pMilliliters);
+// gets the water content of the cistern of the channel in milliliters by binary search and linear interpolation of the saved table
+// reads the points directly from flash; no memory is allocated
+// pWaterLevel: the water level in 1/DISTANCE_UNITS_PER_MM mm
+// returns FALSE if there is no saved table with at least two points for the channel
+unsigned char ICACHE_FLASH_ATTR strappingtable_getMilliliters(unsigned char pChannel, sint32 pWaterLevel, uint32 *pMilliliters);
+
+#endif // __strappingtable_H__
\ No newline at end of file
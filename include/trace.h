@@ -0,0 +1,89 @@
+/*
+* ----------------------------------------------------------------------------
+* The MIT License (MIT)
+*
+* Copyright (c) 2016 - Matthias Jentsch
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+* ----------------------------------------------------------------------------
+*/
+
+#ifndef __trace_H__
+#define __trace_H__
+
+// magic number at the beginning of a trace ("UT" for ultrasonic trace)
+#define TRACE_MAGIC 0x5455
+// version of the trace layout; change it if the layout of TraceHeader or TraceRecord changes
+#define TRACE_VERSION 1
+// max count of records in one trace; further events of the measurement cycle are dropped
+#define TRACE_MAX_RECORDS 64
+// max count of ultrasonic sensor channels in one trace
+#define TRACE_MAX_CHANNELS 2
+
+// record types
+// the trigger pulse of a shot is fired
+#define TRACE_TRIGGER 1
+// the rising edge of the echo pulse was received
+#define TRACE_RISING_EDGE 2
+// the falling edge of the echo pulse was received
+#define TRACE_FALLING_EDGE 3
+// no echo was received for the shot
+#define TRACE_TIMEOUT 4
+
+// one recorded event of a measurement cycle
+typedef struct
+{
+	uint8 type;	// TRACE_TRIGGER, TRACE_RISING_EDGE, TRACE_FALLING_EDGE or TRACE_TIMEOUT
+	uint8 channel;	// the ultrasonic sensor channel
+	uint16 reserved;	// aligned to 4-byte boundary
+	uint32 timestamp;	// timestamp of the event in ticks; see ticksPerUs
+} TraceRecord;
+
+// header of a trace; all values are little endian
+typedef struct
+{
+	uint16 magic;	// TRACE_MAGIC; otherwise the trace is not valid
+	uint8 version;	// TRACE_VERSION
+	uint8 channelCount;	// count of ultrasonic sensor channels
+	uint16 recordCount;	// count of the valid records
+	uint8 estimator;	// the estimator the firmware uses for the water level; see estimator.h
+	uint8 reserved;	// aligned to 4-byte boundary
+	uint32 ticksPerUs;	// timestamp ticks per microsecond
+	uint32 distanceEmpty[TRACE_MAX_CHANNELS];	// Distance in millimeters water to ultrasonic sensor per channel if the cistern is empty
+} TraceHeader;
+
+// the trace of one measurement cycle as it is stored in flash
+typedef struct
+{
+	TraceHeader header;
+	TraceRecord records[TRACE_MAX_RECORDS];
+} Trace;
+
+// starts recording the trace of a new measurement cycle
+void ICACHE_FLASH_ATTR trace_start(uint8 channelCount, uint32 ticksPerUs);
+// sets the distance in millimeters water to ultrasonic sensor of the channel if the cistern is empty
+void ICACHE_FLASH_ATTR trace_setDistanceEmpty(uint8 channel, uint32 distanceEmpty);
+// records one event of the current measurement cycle
+void ICACHE_FLASH_ATTR trace_record(uint8 type, uint8 channel, uint32 timestamp);
+// stops recording and saves the trace of the current measurement cycle into flash
+void ICACHE_FLASH_ATTR trace_save();
+// reads the last saved trace from flash; returns the size of the trace in bytes or 0 if no valid trace was found
+unsigned short ICACHE_FLASH_ATTR trace_load(Trace *pTrace);
+
+#endif // __trace_H__
\ No newline at end of file
@@ -0,0 +1,42 @@
+/*
+* ----------------------------------------------------------------------------
+* The MIT License (MIT)
+*
+* Copyright (c) 2016 - Matthias Jentsch
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+* ----------------------------------------------------------------------------
+*/
+
+#ifndef __uartsensor_H__
+#define __uartsensor_H__
+
+// driver for ultrasonic sensors that send the distance as UART frame (A02YYUW and similar); see SENSOR_UART
+// the TX pin of the sensor is connected to ECHO_GPIO (GPIO13); UART0 is swapped to GPIO13/GPIO15 while the sensor is read
+// the RX pin of the sensor is connected to TRIGGER_GPIO; it's high while the sensor is read so the sensor sends the filtered distance
+
+// called for every received frame with the distance in millimeters; -1 if no valid frame was received within UART_SENSOR_FRAME_TIMEOUT_MS
+typedef void uartSensor_frameCallback(sint32 pDistanceMm);
+
+// starts reading the frames of the sensor
+void ICACHE_FLASH_ATTR uartSensor_start(uartSensor_frameCallback *pCallback);
+// stops reading the frames and gives UART0 back to the debug output
+void ICACHE_FLASH_ATTR uartSensor_stop();
+
+#endif // __uartsensor_H__
\ No newline at end of file
@@ -27,17 +27,51 @@
 #ifndef __ultrasonicmeter_H__
 #define __ultrasonicmeter_H__
 
+// distances and water levels are fixed point values with this count of units per millimeter (1/10 mm)
+#define DISTANCE_UNITS_PER_MM 10
+
+// value of MeasurementQuality.timeToFirstEcho if no valid echo was received
+#define QUALITY_NO_ECHO_TIME 0xFFFF
+
+// quality of the measurement cycle of one channel; it's kept in RTC memory until the next measurement
+typedef struct
+{
+	unsigned char shotCount;	// count of the fired shots
+	unsigned char validCount;	// count of the shots with a valid echo
+	unsigned char lostCount;	// count of the shots without echo (echo timeout or echo pin stuck high)
+	unsigned char outOfRangeCount;	// count of the shots with an echo farther away than distanceEmpty or in the blind zone of the sensor
+	unsigned short spread;	// difference between the max and the min valid distance in 1/DISTANCE_UNITS_PER_MM mm
+	unsigned short jitter;	// mean absolute difference of consecutive valid distances in 1/DISTANCE_UNITS_PER_MM mm; 0 with less than two valid distances
+	unsigned short timeToFirstEcho;	// milliseconds from the start of the cycle to the first valid echo; QUALITY_NO_ECHO_TIME if there is none
+	unsigned short alignment;	// aligned to 4-byte boundary
+} MeasurementQuality;
+
 typedef void ultrasonicMeter_finishedCallback();
 
-// start the measurment process; that are MAX_MEASUREMENTS one shot ultrasonic measurement cycles
-// with pIsSingleShotMode set to TRUE one single shot measurement can also be started
+// start the measurment process; that are MAX_MEASUREMENTS one shot ultrasonic measurement cycles per channel
+// with pIsSingleShotMode set to TRUE one single shot measurement per channel can also be started
 void ICACHE_FLASH_ATTR ultrasonicMeter_startMeasurement(ultrasonicMeter_finishedCallback *pFinished, unsigned char pIsSingleShotMode);
-// gets the mean value of measured water level
-float ICACHE_FLASH_ATTR ultrasonicMeter_getWaterLevel();
-// gets the echo quality: 0 = no echo received; 10 = best possible; all 10 measurements are received
-unsigned char ICACHE_FLASH_ATTR ultrasonicMeter_getEchoQuality();
-// gets the distance that is measured in single shot mode
-float ICACHE_FLASH_ATTR ultrasonicMeter_getSingleShotDistance();
+// gets the estimated water level of the channel in 1/DISTANCE_UNITS_PER_MM mm; see ULTRASONIC_ESTIMATOR
+sint32 ICACHE_FLASH_ATTR ultrasonicMeter_getWaterLevel(unsigned char pChannel);
+// gets the dispersion (median absolute deviation) of the valid distances of the channel of the last measurement cycle in 1/DISTANCE_UNITS_PER_MM mm
+sint32 ICACHE_FLASH_ATTR ultrasonicMeter_getDispersion(unsigned char pChannel);
+// gets the quality of the last measurement cycle of the channel
+void ICACHE_FLASH_ATTR ultrasonicMeter_getQuality(unsigned char pChannel, MeasurementQuality *pQuality);
+// gets the count of shots of the channel that are fired in the last measurement cycle
+unsigned char ICACHE_FLASH_ATTR ultrasonicMeter_getShotCount(unsigned char pChannel);
+// gets the count of valid shots of the channel in the last measurement cycle
+unsigned char ICACHE_FLASH_ATTR ultrasonicMeter_getValidShotCount(unsigned char pChannel);
+// sets the max count of shots per channel for the next measurement cycles; limited to MAX_MEASUREMENTS
+void ICACHE_FLASH_ATTR ultrasonicMeter_setMaxShots(unsigned char pMaxShots);
+// enables or disables the early stop of the next measurement cycles; enabled by default; no effect without ULTRASONIC_EARLY_STOP
+void ICACHE_FLASH_ATTR ultrasonicMeter_setEarlyStop(unsigned char pIsEnabled);
+// gets the difference between the max and the min valid distance of the channel of the last measurement cycle in 1/DISTANCE_UNITS_PER_MM mm
+sint32 ICACHE_FLASH_ATTR ultrasonicMeter_getSpread(unsigned char pChannel);
+// gets the distance of the channel that is measured in single shot mode in 1/DISTANCE_UNITS_PER_MM mm
+sint32 ICACHE_FLASH_ATTR ultrasonicMeter_getSingleShotDistance(unsigned char pChannel);
+// gets the distances of all shots of the channel of the last measurement cycle in 1/DISTANCE_UNITS_PER_MM mm; negative if the shot is invalid
+// the count of distances is ultrasonicMeter_getShotCount
+const sint32* ICACHE_FLASH_ATTR ultrasonicMeter_getDistances(unsigned char pChannel);
 
 #endif // __ultrasonicmeter_H__
 
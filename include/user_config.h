@@ -35,25 +35,118 @@
 
 // URL for ThingSpeak
 #define THINGSPEAK_URL "%s/update?key=%s&field1=%d&field2=%d&field3=%d"
+// additional ThingSpeak fields for the second cistern; see ULTRASONIC_CHANNEL_COUNT
+#define THINGSPEAK_URL_SECOND_CISTERN "&field4=%d&field5=%d&field6=%d"
 
 // turning the modem on or off works via a deep sleep cycle with 1 second
 #define DEEP_SLEEP_PERIOD_FOR_MODEM_ACTIVATION 1
 
 // version for the configuration data
-#define CONFIGURATION_DATA_VERSION 3
-// start sector in flash for configuration data (3 x 4KB blocks)
-#define CONFIGURATION_DATA_START_SEC 0x75
-// how many 4KB blocks of flash will be used for logging?
-#define LOG_DATA_MAX_BLOCKS 4
-// start sector in flash for the log
-#define LOG_DATA_START_SEC 0x78
+#define CONFIGURATION_DATA_VERSION 6
+
+// ultrasonic sensor type; see sensor.h
+#define ULTRASONIC_SENSOR SENSOR_HCSR04
+// count of ultrasonic sensors (trigger/echo pairs; one per cistern) that are measured in one wake up; 1 or 2; see io.h for the pins
+#define ULTRASONIC_CHANNEL_COUNT 1
+// use the CPU cycle counter (CCOUNT) instead of the system time (1 microsecond resolution) for timing the ultrasonic echo
+#define ULTRASONIC_CCOUNT_CAPTURE
+// stop the measurement cycle as soon as at least EARLY_STOP_MIN_SHOTS valid shots are received
+// and the difference between the max and the min valid distance is not greater than EARLY_STOP_MAX_SPREAD_MM
+#define ULTRASONIC_EARLY_STOP
+#define EARLY_STOP_MIN_SHOTS 3
+#define EARLY_STOP_MAX_SPREAD_MM 10
+// estimator for the water level; see estimator.h
+#define ULTRASONIC_ESTIMATOR ESTIMATOR_HAMPEL_MEAN
+// diagnostic mode: record the trigger times, the echo edges and the timeouts of every measurement cycle into flash
+// the trace of the last cycle can be read in the configuration mode and replayed with tools/tracereplay.c
+// every measurement cycle erases one flash sector; so don't enable it for a long time and never in the continuous mode
+// the trace takes the last log sector; see the flash map below
+//#define ULTRASONIC_TRACE
+// combine the measurements of several wake ups with a level filter; the filter state is stored in RTC memory
+#define LEVEL_FILTER
+// if the level filter is settled and the signal of the last wake up was clean only this count of shots is fired per wake up
+#define LEVEL_FILTER_SHOTS 3
+// the signal of a measurement cycle is clean if no shot was lost or out of range and the jitter isn't greater than this value
+#define CLEAN_SIGNAL_MAX_JITTER_MM 5
+// switch the supply of the ultrasonic sensors with SENSOR_POWER_GPIO (see io.h); the sensors are only powered during the shots
+// the settle time after switching on is tuned with the validity of the first shots and kept in RTC memory
+// meant for battery powered gauges; in the continuous mode the settle time delays every measurement period
+//#define SENSOR_POWER_GATING
 
 // Posting the data should not last longer than 60 seconds
 #define POST_MEASUREMENT_TIMEOUT 60
+// the posting wake up measures again while the module connects to the access point and posts the fresh water levels
+// instead of the saved ones of the wake up before; the measurement is done with MEASURE_WHILE_POSTING_SHOTS shots per channel
+// with FORCED_MODEM_SLEEP a post that is called for by a measurement is done in the measurement wake up with its just measured
+// water levels; then there is no second measurement and only the other posting wake ups measure while posting
+#define MEASURE_WHILE_POSTING
+#define MEASURE_WHILE_POSTING_SHOTS 3
+
+// the measurement wake up boots with the modem in the forced modem sleep instead of without modem
+// if the measurement calls for a post the modem is woken up and the data is posted in the same wake up
+// without the extra deep sleep cycle of DEEP_SLEEP_PERIOD_FOR_MODEM_ACTIVATION and the second boot
+// but every measurement wake up boots with the RF initialization (deep sleep option 2 instead of 4); that costs more
+// energy than the saved boot if most measurements aren't posted; so only enable it if posts are frequent
+//#define FORCED_MODEM_SLEEP
+
+// connect to the access point of the last connection on its channel with its IP addresses instead of scanning and DHCP
+// the parameters are kept in RTC memory; if the fast connection fails within WIFI_FAST_CONNECT_TIMEOUT milliseconds the module scans
+// after WIFI_FAST_CONNECT_MAX_USES fast connections DHCP is used again; so the lease of the IP is renewed
+#define WIFI_FAST_CONNECT
+#define WIFI_FAST_CONNECT_TIMEOUT 2000
+#define WIFI_FAST_CONNECT_MAX_USES 20
+
+// min measurement period in milliseconds of the continuous mode (10 Hz); see ContinuousPeriod in the configuration
+#define CONTINUOUS_MIN_PERIOD_MS 100
+// keep alive time in seconds of the MQTT connection that is kept open in the continuous mode
+#define CONTINUOUS_MQTT_KEEPALIVE 60
+// publish the quality of the last measurement cycle per cistern under <topic>/quality as JSON; for monitoring the sensors
+//#define MQTT_PUBLISH_QUALITY
+// batch and burst posting: every measurement is added with its time to a batch in RTC memory instead of being dropped
+// the whole batch is posted in one connection if it's full, the data is older than MaxDataAgeToPost
+// or the water level differs more than MinDifferenceToPost from the last posted one
+// the batch is published via MQTT as JSON array [[<seconds before posting>, <water level in mm>], ...] under <topic>/batch
+// so a configuration without MQTT is rejected; the batch is kept until it's published even if Thingspeak got the values
+// with MEASURE_WHILE_POSTING the fresh measurement of the posting wake up is added as the last point
+// the batch costs (2 + 2 * ULTRASONIC_CHANNEL_COUNT) * BATCH_MAX_POINTS bytes of the 512 bytes RTC memory
+//#define BATCH_POSTING
+#define BATCH_MAX_POINTS 32
+// derive the flow rate, the consumption of the last 24 hours and the time to empty per cistern on the device; the state is stored in RTC memory
+// they are published via MQTT under <topic>/flow (liters per hour), <topic>/consumption (liters) and <topic>/timetoempty (minutes; -1 if not emptying)
+#define DERIVED_METRICS
+// changes of the water level smaller than this value are noise and don't count as consumption
+#define METRICS_DEADBAND_MM 3
+// time constant in seconds of the smoothing of the flow rate
+#define METRICS_RATE_TIME_CONSTANT 3600
 
 // How long should the config button pressed at least before entering the configuration mode (2 seconds)
 #define CONFIG_BUTTON_MIN_HOLD_DURATION 2
 
+// flash map of the 512 KB flash (SPISize 0) in 4KB sectors; the SDK needs the last four sectors
+//   0x00 - 0x74: firmware (irom0 ends at 0x75000)
+//   0x75 - 0x77: configuration data (protected write to three sectors)
+//   0x78 - 0x7A: log; 0x78 - 0x79 if ULTRASONIC_TRACE is defined
+//   0x7A:        ultrasonic trace if ULTRASONIC_TRACE is defined
+//   0x7B:        strapping tables
+//   0x7C:        SDK RF init data (esp_init_data_default.bin); never erase it
+//   0x7D - 0x7F: SDK system parameters; never erase them
+// the volume tables are not stored in flash; see volumetable.h
+// start sector in flash for configuration data (3 x 4KB blocks)
+#define CONFIGURATION_DATA_START_SEC 0x75
+// start sector in flash for the log
+#define LOG_DATA_START_SEC 0x78
+#ifdef ULTRASONIC_TRACE
+// how many 4KB blocks of flash will be used for logging? the last log block is used by the trace
+#define LOG_DATA_MAX_BLOCKS 2
+// start sector in flash for the ultrasonic trace (1 x 4KB block)
+#define TRACE_DATA_START_SEC 0x7A
+#else
+// how many 4KB blocks of flash will be used for logging?
+#define LOG_DATA_MAX_BLOCKS 3
+#endif
+// start sector in flash for the strapping tables of the cisterns of type 3 (1 x 4KB block); see strappingtable.h
+#define STRAPPING_TABLE_START_SEC 0x7B
+
 // For the MQTT part
 //#define MQTT_SSL_ENABLE
 #define MQTT_BUF_SIZE   1024
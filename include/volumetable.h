@@ -0,0 +1,43 @@
+/*
+* ----------------------------------------------------------------------------
+* The MIT License (MIT)
+*
+* Copyright (c) 2016 - Matthias Jentsch
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+* ----------------------------------------------------------------------------
+*/
+
+#ifndef __volumetable_H__
+#define __volumetable_H__
+
+// the volume of the cisterns with a closed form (see volumetable_build) is tabulated at this count of equal level steps from the bottom to the top
+#define VOLUME_TABLE_SEGMENTS 128
+
+// builds the volume tables of the horizontal cylinder, sphere, rectangular, truncated cone and domed horizontal cylinder cisterns
+// of the configuration into RAM; the tables are not stored in flash
+// called by the first lookup of a wake up; call it again if the cistern parameters change
+void ICACHE_FLASH_ATTR volumetable_build();
+// gets the water content of the cistern of the channel in milliliters by linear interpolation of the table
+// pWaterLevel: the water level in 1/DISTANCE_UNITS_PER_MM mm
+// returns FALSE if the cistern of the channel isn't tabulated; then the content must be calculated
+// the soft-float math only runs when the tables are built; a lookup only uses 32-bit integer math
+unsigned char ICACHE_FLASH_ATTR volumetable_getMilliliters(unsigned char pChannel, sint32 pWaterLevel, uint32 *pMilliliters);
+
+#endif // __volumetable_H__
\ No newline at end of file
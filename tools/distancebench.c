@@ -0,0 +1,206 @@
+/*
+* ----------------------------------------------------------------------------
+* The MIT License (MIT)
+*
+* Copyright (c) 2016 - Matthias Jentsch
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+* ----------------------------------------------------------------------------
+*/
+
+// compares the conversion of an echo time into a distance and the posting decision of the firmware before and after
+// the change to fixed point values on a Linux host: the float division by US_PER_MM with the fabs comparison against the
+// integer quotient/remainder conversion of ultrasonicMeter_storeDistance with the integer comparison of powermanagement_checkCurrentMeasurement
+// both variants get the same random echo times; the output is one tab separated line per CPU frequency with the largest
+// difference of the two distances and the time per sample
+// the times are only a relative measure; a host with a floating point unit divides floats faster than integers, the ESP8266
+// has no floating point unit and calls a soft-float routine for every float operation and conversion (about ten per sample
+// in the baseline against one integer division and one modulo in the fixed point version)
+//
+// build (from the repository root):
+//   gcc -std=c99 -O2 -Itools/host -Iinclude -o distancebench tools/distancebench.c -lm
+// usage:
+//   ./distancebench [-n <samples>] [-r <seed>] [-e <distance empty mm>] [-d <min difference to post mm>]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include "c_types.h"
+#include <ultrasonicmeter.h>
+
+// the conversion before the change to fixed point values (see user/ultrasonicmeter.c)
+#define US_PER_MM 5.8
+// the conversion after the change
+#define US_PER_CM 58
+
+// the CPU frequencies of the ESP8266 in MHz; the timer ticks per microsecond
+static const uint32 distancebench_ticksPerUs[] = { 80, 160 };
+
+// the random echo times in timer ticks
+static uint32 *distancebench_ticks;
+static int distancebench_sampleCount = 1000000;
+static unsigned int distancebench_distanceEmpty = 1500;
+static unsigned int distancebench_minDifference = 10;
+
+// the baseline: the distance in mm as float and the posting decision with fabs; delivers the count of posts
+static int distancebench_float(uint32 pTicksPerUs, float *pDistances)
+{
+	float lastWaterLevel = 0;
+	int posts = 0;
+	for (int i = 0; i < distancebench_sampleCount; i++)
+	{
+		float distance = (float)distancebench_ticks[i] / ((float)pTicksPerUs * (float)US_PER_MM);
+		if (distance > (float)distancebench_distanceEmpty)
+		{
+			distance = -1;
+		}
+		pDistances[i] = distance;
+		float waterLevel = (float)distancebench_distanceEmpty - distance;
+		if (fabs(lastWaterLevel - waterLevel) >= (double)distancebench_minDifference)
+		{
+			lastWaterLevel = waterLevel;
+			posts++;
+		}
+	}
+	return posts;
+}
+
+// the fixed point version: the distance in 1/DISTANCE_UNITS_PER_MM mm and the integer posting decision; delivers the count of posts
+static int distancebench_fixedPoint(uint32 pTicksPerUs, sint32 *pDistances)
+{
+	sint32 lastWaterLevel = 0;
+	int posts = 0;
+	for (int i = 0; i < distancebench_sampleCount; i++)
+	{
+		uint32 ticks = distancebench_ticks[i];
+		uint32 ticksPerCm = pTicksPerUs * US_PER_CM;
+		sint32 distance = (sint32)((ticks / ticksPerCm) * 10 * DISTANCE_UNITS_PER_MM + (ticks % ticksPerCm) * 10 * DISTANCE_UNITS_PER_MM / ticksPerCm);
+		if (distance > (sint32)distancebench_distanceEmpty * DISTANCE_UNITS_PER_MM)
+		{
+			distance = -1;
+		}
+		pDistances[i] = distance;
+		sint32 waterLevel = (sint32)distancebench_distanceEmpty * DISTANCE_UNITS_PER_MM - distance;
+		sint32 difference = lastWaterLevel - waterLevel;
+		if (difference < 0)
+		{
+			difference = -difference;
+		}
+		if (difference >= (sint32)distancebench_minDifference * DISTANCE_UNITS_PER_MM)
+		{
+			lastWaterLevel = waterLevel;
+			posts++;
+		}
+	}
+	return posts;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int seed = 1;
+	int arg = 1;
+
+	// options
+	while (arg + 1 < argc && argv[arg][0] == '-')
+	{
+		if (strcmp(argv[arg], "-n") == 0)
+		{
+			distancebench_sampleCount = atoi(argv[arg + 1]);
+		}
+		else if (strcmp(argv[arg], "-r") == 0)
+		{
+			seed = (unsigned int)atoi(argv[arg + 1]);
+		}
+		else if (strcmp(argv[arg], "-e") == 0)
+		{
+			distancebench_distanceEmpty = (unsigned int)atoi(argv[arg + 1]);
+		}
+		else if (strcmp(argv[arg], "-d") == 0)
+		{
+			distancebench_minDifference = (unsigned int)atoi(argv[arg + 1]);
+		}
+		else
+		{
+			break;
+		}
+		arg += 2;
+	}
+	if (arg < argc || distancebench_sampleCount <= 0 || distancebench_distanceEmpty == 0)
+	{
+		fprintf(stderr, "usage: %s [-n <samples>] [-r <seed>] [-e <distance empty mm>] [-d <min difference to post mm>]\n", argv[0]);
+		return 2;
+	}
+	distancebench_ticks = malloc(distancebench_sampleCount * sizeof(uint32));
+	float *floatDistances = malloc(distancebench_sampleCount * sizeof(float));
+	sint32 *fixedPointDistances = malloc(distancebench_sampleCount * sizeof(sint32));
+	if (distancebench_ticks == NULL || floatDistances == NULL || fixedPointDistances == NULL)
+	{
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+
+	printf("# %d samples; distance empty %u mm; min difference to post %u mm\n", distancebench_sampleCount, distancebench_distanceEmpty, distancebench_minDifference);
+	printf("# ticks-per-us\tmax-difference-mm\tposts-float\tposts-fixed-point\tns-float\tns-fixed-point\n");
+	for (unsigned int f = 0; f < sizeof(distancebench_ticksPerUs) / sizeof(distancebench_ticksPerUs[0]); f++)
+	{
+		uint32 ticksPerUs = distancebench_ticksPerUs[f];
+		// random echo times up to 10 % beyond the empty cistern so that some samples are invalid
+		srand(seed);
+		uint32 maxTicks = (uint32)(distancebench_distanceEmpty * 1.1 * US_PER_MM * ticksPerUs);
+		for (int i = 0; i < distancebench_sampleCount; i++)
+		{
+			distancebench_ticks[i] = (uint32)((double)rand() / RAND_MAX * maxTicks);
+		}
+
+		// the time per sample; the best of some repetitions
+		double nsFloat = 1e30;
+		double nsFixedPoint = 1e30;
+		int postsFloat = 0;
+		int postsFixedPoint = 0;
+		for (int repetition = 0; repetition < 5; repetition++)
+		{
+			clock_t start = clock();
+			postsFloat = distancebench_float(ticksPerUs, floatDistances);
+			double ns = (double)(clock() - start) / CLOCKS_PER_SEC * 1e9 / distancebench_sampleCount;
+			nsFloat = ns < nsFloat ? ns : nsFloat;
+			start = clock();
+			postsFixedPoint = distancebench_fixedPoint(ticksPerUs, fixedPointDistances);
+			ns = (double)(clock() - start) / CLOCKS_PER_SEC * 1e9 / distancebench_sampleCount;
+			nsFixedPoint = ns < nsFixedPoint ? ns : nsFixedPoint;
+		}
+
+		// the largest difference of the valid distances of both variants
+		double maxDifference = 0;
+		for (int i = 0; i < distancebench_sampleCount; i++)
+		{
+			if (floatDistances[i] > 0 && fixedPointDistances[i] > 0)
+			{
+				double difference = fabs(floatDistances[i] - (double)fixedPointDistances[i] / DISTANCE_UNITS_PER_MM);
+				maxDifference = difference > maxDifference ? difference : maxDifference;
+			}
+		}
+		printf("%u\t%.3f\t%d\t%d\t%.2f\t%.2f\n", ticksPerUs, maxDifference, postsFloat, postsFixedPoint, nsFloat, nsFixedPoint);
+	}
+	free(distancebench_ticks);
+	free(floatDistances);
+	free(fixedPointDistances);
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,827 @@
+/*
+* ----------------------------------------------------------------------------
+* The MIT License (MIT)
+*
+* Copyright (c) 2016 - Matthias Jentsch
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+* ----------------------------------------------------------------------------
+*/
+
+// simulates the ultrasonic meter on a Linux host; user/ultrasonicmeter.c runs unchanged against a simulated GPIO, hardware timer
+// and system task layer (see the headers in tools/host) and an echo model of the sensors with noise, dropouts, multipath and stuck echo pins
+// every shot count from 1 to SIM_MAX_SHOTS measures the same random water levels without the early stop; with ULTRASONIC_EARLY_STOP
+// one more run with SIM_MAX_SHOTS and the early stop follows; the output is one tab separated line per run and estimator
+// with the error of the water level, the mean count of the fired shots and the virtual awake time of the measurement cycle
+// with -d the water level of the first sensor then falls steadily with the given rate from wake up to wake up (up to <cycles> wake ups)
+// and the water levels of the firmware are combined by the level filter (user/levelfilter.c) like in powermanagement_filterMeasurement;
+// the output is one more line with the error of the filtered water level and the count of the restarts of the filter
+//
+// build (from the repository root):
+//   gcc -std=c99 -O2 -Itools/host -Iinclude -o echosim tools/echosim.c user/ultrasonicmeter.c user/estimator.c user/levelfilter.c -lm
+// usage:
+//   ./echosim [-v] [-n <cycles>] [-r <seed>] [-e <distance empty mm>] [-g <noise mm>] [-p <dropout probability>]
+//             [-m <multipath probability>] [-k <stuck-high probability>] [-K <stuck-high ms>] [-j <interrupt latency us>] [-t <max rms error mm>]
+//             [-s <deep sleep s>] [-d <draw-down mm per hour>]
+// the exit status is 1 if a measurement cycle doesn't finish, if the firmware doesn't deliver the water level of its estimator,
+// (with -t) if the RMS error of the firmware's estimator exceeds the given value for a shot count from LEVEL_FILTER_SHOTS on
+// or (with -d) if the steady draw-down restarts the level filter; so accuracy regressions are caught before flashing
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <math.h>
+#include "c_types.h"
+#include "osapi.h"
+#include "user_interface.h"
+#include "gpio.h"
+#include <io.h>
+#include <sensor.h>
+#include <hwtimer.h>
+#include <estimator.h>
+#include <levelfilter.h>
+#include <trace.h>
+#include <ultrasonicmeter.h>
+#include <configuration.h>
+#include <powermanagement.h>
+
+#if !SENSOR_HAS_ECHO_PULSE
+#error "the simulation needs a sensor with an echo pulse; see ULTRASONIC_SENSOR"
+#endif
+
+// max count of shots per channel and measurement cycle; MAX_MEASUREMENTS in user/ultrasonicmeter.c
+#define SIM_MAX_SHOTS 10
+#ifdef ULTRASONIC_EARLY_STOP
+// count of runs per water level; the shot counts without the early stop and SIM_MAX_SHOTS with the early stop
+#define SIM_RUNS (SIM_MAX_SHOTS + 1)
+#else
+#define SIM_RUNS SIM_MAX_SHOTS
+#endif
+// count of estimators; see estimator.h
+#define ESTIMATOR_COUNT 4
+// Unit of measurement according to the datashett of HC-SR04; the same as in user/ultrasonicmeter.c
+#define US_PER_CM 58
+// the sensor starts the echo pulse this time in us after the end of the trigger pulse; that's the time for sending the burst
+#define SIM_ECHO_START_DELAY_US 500
+// the sensor ignores trigger pulses shorter than this time in us
+#define SIM_MIN_TRIGGER_US 10
+// the system task runs this time in us after an event was posted
+#define SIM_TASK_LATENCY_US 50
+// a multipath echo is reflected twice between the water and the ceiling of the cistern
+#define SIM_MULTIPATH_FACTOR 2.0
+// a measurement cycle that lasts longer than this virtual time in us doesn't finish
+#define SIM_CYCLE_TIMEOUT_US 10000000ULL
+// the virtual deep sleep between two measurement cycles in us if it isn't given with -s
+#define SIM_SLEEP_US 60000000ULL
+// max count of pending events
+#define SIM_MAX_EVENTS 32
+// count of GPIO pins
+#define SIM_GPIO_COUNT 16
+
+// event types
+// the echo model changes the level of an echo pin
+#define EVENT_PIN 0
+// the GPIO interrupt is delivered to the interrupt handler
+#define EVENT_GPIO_INTERRUPT 1
+// the system task processes one posted event
+#define EVENT_TASK 2
+
+// one pending event of the simulation
+typedef struct
+{
+	uint64_t time;	// virtual time in us
+	unsigned char type;	// EVENT_PIN, EVENT_GPIO_INTERRUPT or EVENT_TASK
+	unsigned char pin;	// the pin of EVENT_PIN
+	unsigned char level;	// the new level of EVENT_PIN
+} SimEvent;
+
+// parameters of the echo model
+typedef struct
+{
+	double noiseMm;	// standard deviation of the distance of an echo in mm
+	double dropoutProbability;	// probability of a shot without echo pulse
+	double multipathProbability;	// probability of an echo that is reflected twice (see SIM_MULTIPATH_FACTOR)
+	double stuckProbability;	// probability of an echo pin that gets stuck high after the trigger
+	uint32 stuckMs;	// time in milliseconds the echo pin is stuck high
+	uint32 interruptLatencyUs;	// max latency of the GPIO interrupt in us; the timestamp of an edge is delayed by 0 to this value
+} EchoModel;
+
+// the error statistics of one shot count and estimator
+typedef struct
+{
+	double sumAbsError;	// in mm
+	double sumSquaredError;	// in mm^2
+	double maxAbsError;	// in mm
+	unsigned long count;	// count of estimated water levels
+	unsigned long failed;	// count of channels without water level (no valid shot)
+} SimErrors;
+
+// the names of the estimators
+static const char *echosim_estimatorNames[ESTIMATOR_COUNT] = { "trimmed-mean", "median", "hampel-mean", "interquartile-mean" };
+// the trigger and the echo pins of the sensor channels; see io.h
+static const unsigned char echosim_triggerGpios[] = { TRIGGER_GPIO, TRIGGER_GPIO_2 };
+static const unsigned char echosim_echoGpios[] = { ECHO_GPIO, ECHO_GPIO_2 };
+
+// the virtual time in us; starts shortly before the 32 bit system time wraps around
+static uint64_t echosim_time = 0xFFFFFFFFULL - 30000000ULL;
+// the pending events
+static SimEvent echosim_events[SIM_MAX_EVENTS];
+static int echosim_eventCount = 0;
+// the hardware timer
+static hwtimer_callback *echosim_hwtimerCallback = NULL;
+static uint64_t echosim_hwtimerDue;
+static unsigned char echosim_isHwtimerArmed = FALSE;
+// the armed os timers
+static ETSTimer *echosim_timers = NULL;
+// the system task and the count of posted events
+static os_task_t echosim_task = NULL;
+static uint8 echosim_taskQueueSize = 0;
+static uint8 echosim_taskPending = 0;
+// the GPIO pins and the GPIO interrupt
+static uint32 echosim_pinLevels = 0;
+static GPIO_INT_TYPE echosim_pinInterrupts[SIM_GPIO_COUNT];
+static uint32 echosim_gpioStatus = 0;
+static sim_gpioIsr echosim_gpioIsr = NULL;
+static void *echosim_gpioIsrArg = NULL;
+static unsigned char echosim_isGpioInterruptEnabled = FALSE;
+// start of the trigger pulse per channel in virtual time
+static uint64_t echosim_triggerStart[ULTRASONIC_CHANNEL_COUNT];
+
+// the echo model and the true distances of the sensors in mm
+static EchoModel echosim_model = { 2.0, 0.0, 0.0, 0.0, 60, 2 };
+static double echosim_trueDistances[ULTRASONIC_CHANNEL_COUNT];
+static unsigned int echosim_distanceEmpty = 1500;
+// the virtual deep sleep between two measurement cycles in us
+static uint64_t echosim_sleepUs = SIM_SLEEP_US;
+// counters of simulation problems
+static unsigned long echosim_shortTriggerPulses = 0;
+static unsigned long echosim_droppedPosts = 0;
+// state of the random generator (xorshift64*)
+static uint64_t echosim_randomState = 1;
+// TRUE if the output of the firmware should be printed
+static unsigned char echosim_isVerbose = FALSE;
+// TRUE after the firmware has finished the measurement cycle
+static unsigned char echosim_isFinished = FALSE;
+
+// delivers a random value from 0 to 1 (exclusive)
+static double echosim_random()
+{
+	echosim_randomState ^= echosim_randomState >> 12;
+	echosim_randomState ^= echosim_randomState << 25;
+	echosim_randomState ^= echosim_randomState >> 27;
+	return (double)((echosim_randomState * 2685821657736338717ULL) >> 11) / 9007199254740992.0;
+}
+
+// delivers a normal distributed random value with standard deviation 1 (Box-Muller)
+static double echosim_gaussian()
+{
+	double u1 = 1.0 - echosim_random();
+	double u2 = echosim_random();
+	return sqrt(-2.0 * log(u1)) * cos(2.0 * 3.14159265358979323846 * u2);
+}
+
+// adds a pending event
+static void echosim_addEvent(uint64_t time, unsigned char type, unsigned char pin, unsigned char level)
+{
+	if (echosim_eventCount >= SIM_MAX_EVENTS)
+	{
+		fprintf(stderr, "too many pending events\n");
+		exit(2);
+	}
+	SimEvent *event = &echosim_events[echosim_eventCount++];
+	event->time = time;
+	event->type = type;
+	event->pin = pin;
+	event->level = level;
+}
+
+// sets the level of a pin; raises the GPIO interrupt if the edge is enabled (see gpio_pin_intr_state_set)
+static void echosim_setPin(unsigned char pin, unsigned char level)
+{
+	if (((echosim_pinLevels >> pin) & 1) == level)
+	{
+		return;
+	}
+	echosim_pinLevels = level ? (echosim_pinLevels | BIT(pin)) : (echosim_pinLevels & ~BIT(pin));
+	GPIO_INT_TYPE type = echosim_pinInterrupts[pin];
+	if (type == GPIO_PIN_INTR_ANYEDGE || (level && type == GPIO_PIN_INTR_POSEDGE) || (!level && type == GPIO_PIN_INTR_NEGEDGE))
+	{
+		echosim_gpioStatus |= BIT(pin);
+		uint32 latency = (uint32)(echosim_random() * (echosim_model.interruptLatencyUs + 1));
+		echosim_addEvent(echosim_time + latency, EVENT_GPIO_INTERRUPT, pin, 0);
+	}
+}
+
+// the echo model; the sensor of the channel has received a trigger pulse
+static void echosim_fireShot(unsigned char channel)
+{
+	unsigned char echoGpio = echosim_echoGpios[channel];
+	uint64_t start = echosim_time + SIM_ECHO_START_DELAY_US;
+	double distance = echosim_trueDistances[channel];
+	double r = echosim_random();
+
+	// a stuck echo pin ignores the trigger
+	if (echosim_pinLevels & BIT(echoGpio))
+	{
+		return;
+	}
+	if (r < echosim_model.stuckProbability)
+	{
+		echosim_addEvent(start, EVENT_PIN, echoGpio, 1);
+		echosim_addEvent(start + echosim_model.stuckMs * 1000ULL, EVENT_PIN, echoGpio, 0);
+		return;
+	}
+	r -= echosim_model.stuckProbability;
+	if (r < echosim_model.dropoutProbability)
+	{
+		return;
+	}
+	r -= echosim_model.dropoutProbability;
+	if (r < echosim_model.multipathProbability)
+	{
+		distance *= SIM_MULTIPATH_FACTOR;
+	}
+	distance += echosim_model.noiseMm * echosim_gaussian();
+	if (distance < 0)
+	{
+		distance = 0;
+	}
+	// the width of the echo pulse is the round trip time
+	echosim_addEvent(start, EVENT_PIN, echoGpio, 1);
+	echosim_addEvent(start + (uint64_t)(distance * US_PER_CM / 10 + 0.5), EVENT_PIN, echoGpio, 0);
+}
+
+// advances the virtual time to the next event and processes it; returns FALSE if nothing is pending
+static unsigned char echosim_step()
+{
+	int eventIndex = -1;
+	ETSTimer *timer = NULL;
+	uint64_t next = UINT64_MAX;
+
+	for (int i = 0; i < echosim_eventCount; i++)
+	{
+		if (echosim_events[i].time < next)
+		{
+			next = echosim_events[i].time;
+			eventIndex = i;
+		}
+	}
+	for (ETSTimer *t = echosim_timers; t != NULL; t = t->next)
+	{
+		// the signed difference is also valid if the system time has wrapped around
+		uint64_t due = echosim_time + (sint32)(t->due - (uint32)echosim_time);
+		if (due < next)
+		{
+			next = due;
+			timer = t;
+			eventIndex = -1;
+		}
+	}
+	if (echosim_isHwtimerArmed == TRUE && echosim_hwtimerDue < next)
+	{
+		echosim_time = echosim_hwtimerDue;
+		echosim_isHwtimerArmed = FALSE;
+		echosim_hwtimerCallback();
+		return TRUE;
+	}
+	if (next == UINT64_MAX)
+	{
+		return FALSE;
+	}
+	if (next > echosim_time)
+	{
+		echosim_time = next;
+	}
+
+	if (timer != NULL)
+	{
+		os_timer_disarm(timer);
+		if (timer->periodMs > 0)
+		{
+			os_timer_arm(timer, timer->periodMs, TRUE);
+		}
+		timer->func(timer->arg);
+		return TRUE;
+	}
+
+	// remove the event before it's processed; processing may add new events
+	SimEvent event = echosim_events[eventIndex];
+	echosim_events[eventIndex] = echosim_events[--echosim_eventCount];
+	switch (event.type)
+	{
+	case EVENT_PIN:
+		echosim_setPin(event.pin, event.level);
+		break;
+	case EVENT_GPIO_INTERRUPT:
+		if (echosim_isGpioInterruptEnabled == TRUE && echosim_gpioStatus != 0 && echosim_gpioIsr != NULL)
+		{
+			echosim_gpioIsr(echosim_gpioIsrArg);
+		}
+		break;
+	case EVENT_TASK:
+		if (echosim_taskPending > 0)
+		{
+			echosim_taskPending--;
+			if (echosim_taskPending > 0)
+			{
+				echosim_addEvent(echosim_time, EVENT_TASK, 0, 0);
+			}
+			os_event_t osEvent = { 0, 0 };
+			echosim_task(&osEvent);
+		}
+		break;
+	}
+	return TRUE;
+}
+
+// called by the firmware after the measurement cycle is finished
+static void echosim_measurementFinished()
+{
+	echosim_isFinished = TRUE;
+}
+
+// runs one measurement cycle with the given max count of shots per channel after a virtual deep sleep
+// returns FALSE if the cycle doesn't finish in time
+static unsigned char echosim_runCycle(unsigned char pMaxShots, uint64_t *pAwakeUs)
+{
+	// a new wake up; the echo pins are low and nothing is pending
+	echosim_time += echosim_sleepUs;
+	echosim_eventCount = 0;
+	echosim_isHwtimerArmed = FALSE;
+	echosim_timers = NULL;
+	echosim_taskPending = 0;
+	echosim_pinLevels = 0;
+	echosim_gpioStatus = 0;
+	memset(echosim_pinInterrupts, 0, sizeof(echosim_pinInterrupts));
+
+	uint64_t start = echosim_time;
+	echosim_isFinished = FALSE;
+	ultrasonicMeter_setMaxShots(pMaxShots);
+	ultrasonicMeter_startMeasurement(echosim_measurementFinished, FALSE);
+	while (echosim_isFinished == FALSE && echosim_time - start < SIM_CYCLE_TIMEOUT_US && echosim_step() == TRUE)
+	{
+	}
+	*pAwakeUs = echosim_time - start;
+	return echosim_isFinished;
+}
+
+// adds the error of one estimated distance to the statistics
+static void echosim_addError(SimErrors *pErrors, unsigned char pValid, sint32 pDistance, double pTrueDistance)
+{
+	if (pValid == 0)
+	{
+		pErrors->failed++;
+		return;
+	}
+	double error = fabs((double)pDistance / DISTANCE_UNITS_PER_MM - pTrueDistance);
+	pErrors->sumAbsError += error;
+	pErrors->sumSquaredError += error * error;
+	if (error > pErrors->maxAbsError)
+	{
+		pErrors->maxAbsError = error;
+	}
+	pErrors->count++;
+}
+
+// the water level of the first sensor falls steadily with pRate mm per hour; the measurements of the firmware are combined by the level filter
+// prints the error of the filtered water level; returns FALSE if the level filter is restarted
+static unsigned char echosim_runDrawDown(double pRate, long pMaxWakeUps, unsigned long *pUnfinishedCycles)
+{
+	LevelFilterState filter;
+	SimErrors errors = { 0 };
+	unsigned long restarts = 0;
+	unsigned long misses = 0;
+	unsigned long shots = 0;
+	long wakeUps = 0;
+	uint32 elapsedSeconds = (uint32)(echosim_sleepUs / 1000000);
+	// from the top of the measurement range to the bottom
+	double trueDistance = 2 * SENSOR_MIN_DISTANCE_MM;
+	double step = pRate * elapsedSeconds / 3600.0;
+
+	// like the firmware
+	ultrasonicMeter_setEarlyStop(TRUE);
+	levelfilter_reset(&filter);
+	for (int c = 0; c < ULTRASONIC_CHANNEL_COUNT; c++)
+	{
+		echosim_trueDistances[c] = trueDistance;
+	}
+	for (; wakeUps < pMaxWakeUps && trueDistance < echosim_distanceEmpty * 0.95; wakeUps++, trueDistance += step)
+	{
+		uint64_t awakeUs;
+		echosim_trueDistances[0] = trueDistance;
+		// like the firmware: only a few shots if the level filter is settled
+		if (echosim_runCycle(levelfilter_isSettled(&filter) == TRUE ? LEVEL_FILTER_SHOTS : SIM_MAX_SHOTS, &awakeUs) == FALSE)
+		{
+			(*pUnfinishedCycles)++;
+			continue;
+		}
+		shots += ultrasonicMeter_getShotCount(0);
+		if (ultrasonicMeter_getValidShotCount(0) == 0)
+		{
+			echosim_addError(&errors, 0, 0, trueDistance);
+			continue;
+		}
+		unsigned char isInitialized = filter.variance != 0;
+		sint32 waterLevel = ultrasonicMeter_getWaterLevel(0);
+		sint32 filteredLevel = levelfilter_update(&filter, waterLevel, ultrasonicMeter_getDispersion(0), elapsedSeconds);
+		if (filter.missCount > 0)
+		{
+			misses++;
+		}
+		// a restart takes over the measurement without rate
+		else if (isInitialized == TRUE && filteredLevel == waterLevel && filter.rate == 0)
+		{
+			restarts++;
+		}
+		echosim_addError(&errors, 1, (sint32)echosim_distanceEmpty * DISTANCE_UNITS_PER_MM - filteredLevel, trueDistance);
+	}
+
+	printf("# draw-down %.1f mm/h; deep sleep %u s; %ld wake ups\n", pRate, elapsedSeconds, wakeUps);
+	printf("# draw-down\tlevels\tfailed\tmean-abs-error\trms-error\tmax-abs-error\tmean-shots\toutside-gate\trestarts\trate-mm-h\n");
+	printf("%.1f\t%lu\t%lu\t%.2f\t%.2f\t%.2f\t%.2f\t%lu\t%lu\t%.1f\n", pRate, errors.count, errors.failed,
+		errors.count > 0 ? errors.sumAbsError / errors.count : 0, errors.count > 0 ? sqrt(errors.sumSquaredError / errors.count) : 0,
+		errors.maxAbsError, wakeUps > 0 ? (double)shots / wakeUps : 0, misses, restarts, -(double)filter.rate / DISTANCE_UNITS_PER_MM);
+	if (restarts > 0)
+	{
+		fprintf(stderr, "the steady draw-down of %.1f mm/h restarts the level filter %lu times\n", pRate, restarts);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+int main(int argc, char **argv)
+{
+	static SimErrors errors[SIM_RUNS][ESTIMATOR_COUNT];
+	double awakeMs[SIM_RUNS] = { 0 };
+	unsigned long firedShots[SIM_RUNS] = { 0 };
+	unsigned long unfinishedCycles = 0;
+	unsigned long levelMismatches = 0;
+	long cycles = 1000;
+	unsigned long seed = 1;
+	double maxRmsError = -1;
+	double drawDownRate = 0;
+	int arg = 1;
+
+	// options
+	while (arg < argc && argv[arg][0] == '-')
+	{
+		const char *option = argv[arg];
+		if (strcmp(option, "-v") == 0)
+		{
+			echosim_isVerbose = TRUE;
+			arg++;
+			continue;
+		}
+		if (arg + 1 >= argc || option[1] == 0 || option[2] != 0)
+		{
+			break;
+		}
+		const char *value = argv[arg + 1];
+		switch (option[1])
+		{
+		case 'n': cycles = atol(value); break;
+		case 'r': seed = strtoul(value, NULL, 10); break;
+		case 'e': echosim_distanceEmpty = (unsigned int)atoi(value); break;
+		case 'g': echosim_model.noiseMm = atof(value); break;
+		case 'p': echosim_model.dropoutProbability = atof(value); break;
+		case 'm': echosim_model.multipathProbability = atof(value); break;
+		case 'k': echosim_model.stuckProbability = atof(value); break;
+		case 'K': echosim_model.stuckMs = (uint32)atoi(value); break;
+		case 'j': echosim_model.interruptLatencyUs = (uint32)atoi(value); break;
+		case 't': maxRmsError = atof(value); break;
+		case 's': echosim_sleepUs = (uint64_t)atol(value) * 1000000ULL; break;
+		case 'd': drawDownRate = atof(value); break;
+		default: option = NULL; break;
+		}
+		if (option == NULL)
+		{
+			break;
+		}
+		arg += 2;
+	}
+	if (arg < argc || cycles <= 0 || echosim_distanceEmpty <= 4 * SENSOR_MIN_DISTANCE_MM || echosim_sleepUs == 0 || drawDownRate < 0)
+	{
+		fprintf(stderr, "usage: %s [-v] [-n <cycles>] [-r <seed>] [-e <distance empty mm>] [-g <noise mm>] [-p <dropout probability>]\n"
+			"       [-m <multipath probability>] [-k <stuck-high probability>] [-K <stuck-high ms>] [-j <interrupt latency us>] [-t <max rms error mm>]\n"
+			"       [-s <deep sleep s>] [-d <draw-down mm per hour>]\n", argv[0]);
+		return 2;
+	}
+	echosim_randomState = seed * 0x9E3779B97F4A7C15ULL + 1;
+
+	for (long cycle = 0; cycle < cycles; cycle++)
+	{
+		// the same water levels for all shot counts; between the blind zone and the bottom of the cistern
+		double trueDistances[ULTRASONIC_CHANNEL_COUNT];
+		for (int c = 0; c < ULTRASONIC_CHANNEL_COUNT; c++)
+		{
+			trueDistances[c] = 2 * SENSOR_MIN_DISTANCE_MM + echosim_random() * (echosim_distanceEmpty * 0.95 - 2 * SENSOR_MIN_DISTANCE_MM);
+		}
+		for (int run = 0; run < SIM_RUNS; run++)
+		{
+			uint64_t awakeUs;
+			memcpy(echosim_trueDistances, trueDistances, sizeof(echosim_trueDistances));
+			// the early stop would end most cycles after EARLY_STOP_MIN_SHOTS shots; so only the last run uses it
+			ultrasonicMeter_setEarlyStop(run >= SIM_MAX_SHOTS);
+			if (echosim_runCycle((unsigned char)(run < SIM_MAX_SHOTS ? run + 1 : SIM_MAX_SHOTS), &awakeUs) == FALSE)
+			{
+				unfinishedCycles++;
+				continue;
+			}
+			awakeMs[run] += awakeUs / 1000.0;
+			for (int c = 0; c < ULTRASONIC_CHANNEL_COUNT; c++)
+			{
+				const sint32 *distances = ultrasonicMeter_getDistances(c);
+				unsigned char shotCount = ultrasonicMeter_getShotCount(c);
+				firedShots[run] += shotCount;
+				for (int e = 0; e < ESTIMATOR_COUNT; e++)
+				{
+					sint32 distance;
+					sint32 dispersion;
+					unsigned char valid = estimator_estimate(e, distances, shotCount, &distance, &dispersion);
+					echosim_addError(&errors[run][e], valid, distance, trueDistances[c]);
+					// the firmware must deliver the water level of its estimator
+					if (e == ULTRASONIC_ESTIMATOR && valid > 0 &&
+						ultrasonicMeter_getWaterLevel(c) != (sint32)echosim_distanceEmpty * DISTANCE_UNITS_PER_MM - distance)
+					{
+						levelMismatches++;
+					}
+				}
+			}
+		}
+	}
+
+	printf("# cycles %ld; seed %lu; distance empty %u mm; noise %.1f mm; dropout %.3f; multipath %.3f; stuck-high %.3f (%u ms); interrupt latency %u us\n",
+		cycles, seed, echosim_distanceEmpty, echosim_model.noiseMm, echosim_model.dropoutProbability, echosim_model.multipathProbability,
+		echosim_model.stuckProbability, echosim_model.stuckMs, echosim_model.interruptLatencyUs);
+	printf("# shots\tearly-stop\testimator\tlevels\tfailed\tmean-abs-error\trms-error\tmax-abs-error\tmean-shots\tmean-awake-ms\n");
+	int result = 0;
+	for (int run = 0; run < SIM_RUNS; run++)
+	{
+		int shots = run < SIM_MAX_SHOTS ? run + 1 : SIM_MAX_SHOTS;
+		unsigned long finished = errors[run][0].count + errors[run][0].failed;
+		double meanShots = finished > 0 ? (double)firedShots[run] / finished : 0;
+		double meanAwakeMs = finished > 0 ? awakeMs[run] * ULTRASONIC_CHANNEL_COUNT / finished : 0;
+		for (int e = 0; e < ESTIMATOR_COUNT; e++)
+		{
+			SimErrors *error = &errors[run][e];
+			double meanAbsError = error->count > 0 ? error->sumAbsError / error->count : 0;
+			double rmsError = error->count > 0 ? sqrt(error->sumSquaredError / error->count) : 0;
+			printf("%d\t%s\t%s%s\t%lu\t%lu\t%.2f\t%.2f\t%.2f\t%.2f\t%.1f\n", shots, run >= SIM_MAX_SHOTS ? "yes" : "no",
+				echosim_estimatorNames[e], e == ULTRASONIC_ESTIMATOR ? "*" : "",
+				error->count, error->failed, meanAbsError, rmsError, error->maxAbsError, meanShots, meanAwakeMs);
+			if (maxRmsError >= 0 && e == ULTRASONIC_ESTIMATOR && shots >= LEVEL_FILTER_SHOTS && rmsError > maxRmsError)
+			{
+				fprintf(stderr, "%d shots%s: rms error %.2f mm of the firmware's estimator exceeds %.2f mm\n", shots,
+					run >= SIM_MAX_SHOTS ? " with early stop" : "", rmsError, maxRmsError);
+				result = 1;
+			}
+		}
+	}
+	if (drawDownRate > 0 && echosim_runDrawDown(drawDownRate, cycles, &unfinishedCycles) == FALSE)
+	{
+		result = 1;
+	}
+	if (echosim_shortTriggerPulses > 0 || echosim_droppedPosts > 0)
+	{
+		printf("# %lu trigger pulses too short; %lu task events dropped\n", echosim_shortTriggerPulses, echosim_droppedPosts);
+	}
+	if (unfinishedCycles > 0)
+	{
+		fprintf(stderr, "%lu measurement cycles didn't finish\n", unfinishedCycles);
+		result = 1;
+	}
+	if (levelMismatches > 0)
+	{
+		fprintf(stderr, "%lu water levels of the firmware differ from its estimator\n", levelMismatches);
+		result = 1;
+	}
+	return result;
+}
+
+// the simulated SDK and the firmware modules that ultrasonicmeter.c uses; see the headers in tools/host
+
+int sim_printf(const char *pFormat, ...)
+{
+	if (echosim_isVerbose == FALSE)
+	{
+		return 0;
+	}
+	va_list args;
+	va_start(args, pFormat);
+	int result = vprintf(pFormat, args);
+	va_end(args);
+	return result;
+}
+
+void os_timer_setfn(ETSTimer *pTimer, os_timer_func_t *pFunction, void *pArg)
+{
+	os_timer_disarm(pTimer);
+	pTimer->func = pFunction;
+	pTimer->arg = pArg;
+}
+
+void os_timer_arm(ETSTimer *pTimer, uint32 milliseconds, bool repeatFlag)
+{
+	os_timer_disarm(pTimer);
+	pTimer->due = (uint32)echosim_time + milliseconds * 1000;
+	pTimer->periodMs = repeatFlag ? milliseconds : 0;
+	pTimer->next = echosim_timers;
+	echosim_timers = pTimer;
+}
+
+void os_timer_disarm(ETSTimer *pTimer)
+{
+	for (ETSTimer **t = &echosim_timers; *t != NULL; t = &(*t)->next)
+	{
+		if (*t == pTimer)
+		{
+			*t = pTimer->next;
+			break;
+		}
+	}
+}
+
+uint32 system_get_time(void)
+{
+	return (uint32)echosim_time;
+}
+
+uint8 system_get_cpu_freq(void)
+{
+	return 80;
+}
+
+bool system_os_task(os_task_t task, uint8 prio, os_event_t *queue, uint8 qlen)
+{
+	echosim_task = task;
+	echosim_taskQueueSize = qlen;
+	return TRUE;
+}
+
+bool system_os_post(uint8 prio, os_signal_t sig, os_param_t par)
+{
+	// the queue is full; the event is lost like in the SDK
+	if (echosim_task == NULL || echosim_taskPending >= echosim_taskQueueSize)
+	{
+		echosim_droppedPosts++;
+		return FALSE;
+	}
+	if (echosim_taskPending == 0)
+	{
+		echosim_addEvent(echosim_time + SIM_TASK_LATENCY_US, EVENT_TASK, 0, 0);
+	}
+	echosim_taskPending++;
+	return TRUE;
+}
+
+uint32 sim_gpioRegRead(uint32 reg)
+{
+	return reg == GPIO_STATUS_ADDRESS ? echosim_gpioStatus : 0;
+}
+
+void sim_gpioRegWrite(uint32 reg, uint32 value)
+{
+	if (reg == GPIO_STATUS_W1TC_ADDRESS)
+	{
+		echosim_gpioStatus &= ~value;
+	}
+}
+
+uint32 sim_gpioInputGet(uint32 gpio)
+{
+	return (echosim_pinLevels >> gpio) & 1;
+}
+
+void sim_gpioIntrAttach(sim_gpioIsr pIsr, void *pArg)
+{
+	echosim_gpioIsr = pIsr;
+	echosim_gpioIsrArg = pArg;
+}
+
+void sim_gpioIntrEnable(unsigned char pEnable)
+{
+	echosim_isGpioInterruptEnabled = pEnable;
+	// an interrupt that was raised while disabled is delivered now
+	if (pEnable == TRUE && echosim_gpioStatus != 0)
+	{
+		echosim_addEvent(echosim_time, EVENT_GPIO_INTERRUPT, 0, 0);
+	}
+}
+
+void gpio_output_set(uint32 set_mask, uint32 clear_mask, uint32 enable_mask, uint32 disable_mask)
+{
+	for (int c = 0; c < ULTRASONIC_CHANNEL_COUNT; c++)
+	{
+		unsigned char triggerGpio = echosim_triggerGpios[c];
+		if ((set_mask & BIT(triggerGpio)) && !(echosim_pinLevels & BIT(triggerGpio)))
+		{
+			echosim_triggerStart[c] = echosim_time;
+		}
+		// the sensor fires at the falling edge of the trigger pulse
+		if ((clear_mask & BIT(triggerGpio)) && (echosim_pinLevels & BIT(triggerGpio)))
+		{
+			if (echosim_time - echosim_triggerStart[c] >= SIM_MIN_TRIGGER_US)
+			{
+				echosim_fireShot(c);
+			}
+			else
+			{
+				echosim_shortTriggerPulses++;
+			}
+		}
+	}
+	echosim_pinLevels = (echosim_pinLevels | set_mask) & ~clear_mask;
+}
+
+void gpio_pin_intr_state_set(uint32 i, GPIO_INT_TYPE intr_state)
+{
+	echosim_pinInterrupts[i] = intr_state;
+}
+
+void ICACHE_FLASH_ATTR hwtimer_init(hwtimer_callback *pCallback)
+{
+	echosim_hwtimerCallback = pCallback;
+	echosim_isHwtimerArmed = FALSE;
+}
+
+void hwtimer_arm(uint32 us)
+{
+	// the same limits as in user/hwtimer.c
+	if (us < HWTIMER_MIN_US)
+	{
+		us = HWTIMER_MIN_US;
+	}
+	else if (us > HWTIMER_MAX_US)
+	{
+		us = HWTIMER_MAX_US;
+	}
+	echosim_hwtimerDue = echosim_time + us;
+	echosim_isHwtimerArmed = TRUE;
+}
+
+void hwtimer_disarm()
+{
+	echosim_isHwtimerArmed = FALSE;
+}
+
+unsigned int ICACHE_FLASH_ATTR configuration_getDistanceEmpty(unsigned char channel)
+{
+	return echosim_distanceEmpty;
+}
+
+void ICACHE_FLASH_ATTR io_ledPulse(unsigned short pulsePeriodInMs)
+{
+}
+
+void ICACHE_FLASH_ATTR io_sensorPower(unsigned char state)
+{
+}
+
+// the settle time isn't kept between the program runs
+static unsigned short echosim_sensorSettleTime = 0;
+
+unsigned short ICACHE_FLASH_ATTR powermanagement_getSensorSettleTime()
+{
+	return echosim_sensorSettleTime;
+}
+
+void ICACHE_FLASH_ATTR powermanagement_setSensorSettleTime(unsigned short sensorSettleTime)
+{
+	echosim_sensorSettleTime = sensorSettleTime;
+}
+
+#ifdef ULTRASONIC_TRACE
+// there is no flash; the traces are dropped
+void ICACHE_FLASH_ATTR trace_start(uint8 channelCount, uint32 ticksPerUs)
+{
+}
+
+void ICACHE_FLASH_ATTR trace_setDistanceEmpty(uint8 channel, uint32 distanceEmpty)
+{
+}
+
+void ICACHE_FLASH_ATTR trace_record(uint8 type, uint8 channel, uint32 timestamp)
+{
+}
+
+void ICACHE_FLASH_ATTR trace_save()
+{
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,78 @@
+/*
+* ----------------------------------------------------------------------------
+* The MIT License (MIT)
+*
+* Copyright (c) 2016 - Matthias Jentsch
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+* ----------------------------------------------------------------------------
+*/
+
+// minimal replacement of the SDK header gpio.h; used to build the firmware sources on a Linux host (see tools/echosim.c)
+// the pins and the GPIO interrupt are driven by the echo model of the simulation
+
+#ifndef __gpio_H__
+#define __gpio_H__
+
+#include "c_types.h"
+
+#define BIT(nr) (1UL << (nr))
+
+// register addresses; only the interrupt status registers are simulated
+#define GPIO_STATUS_ADDRESS 0x1c
+#define GPIO_STATUS_W1TC_ADDRESS 0x24
+#define GPIO_PIN_ADDR(i) (0x28 + (i) * 4)
+
+#define GPIO_PIN_INT_TYPE_SET(x) 0
+#define GPIO_PIN_PAD_DRIVER_SET(x) 0
+#define GPIO_PIN_SOURCE_SET(x) 0
+#define GPIO_PAD_DRIVER_DISABLE 0
+#define GPIO_AS_PIN_SOURCE 0
+
+#define GPIO_ID_PIN(n) (n)
+
+typedef enum
+{
+	GPIO_PIN_INTR_DISABLE = 0,
+	GPIO_PIN_INTR_POSEDGE = 1,
+	GPIO_PIN_INTR_NEGEDGE = 2,
+	GPIO_PIN_INTR_ANYEDGE = 3,
+	GPIO_PIN_INTR_LOLEVEL = 4,
+	GPIO_PIN_INTR_HILEVEL = 5
+} GPIO_INT_TYPE;
+
+typedef void (*sim_gpioIsr)(void *arg);
+
+#define GPIO_REG_READ(reg) sim_gpioRegRead(reg)
+#define GPIO_REG_WRITE(reg, val) sim_gpioRegWrite(reg, val)
+#define GPIO_INPUT_GET(gpio_no) sim_gpioInputGet(gpio_no)
+#define ETS_GPIO_INTR_ATTACH(func, arg) sim_gpioIntrAttach((sim_gpioIsr)(func), (void *)(arg))
+#define ETS_GPIO_INTR_ENABLE() sim_gpioIntrEnable(TRUE)
+#define ETS_GPIO_INTR_DISABLE() sim_gpioIntrEnable(FALSE)
+#define gpio_register_set(reg, value) ((void)(reg), (void)(value))
+
+uint32 sim_gpioRegRead(uint32 reg);
+void sim_gpioRegWrite(uint32 reg, uint32 value);
+uint32 sim_gpioInputGet(uint32 gpio);
+void sim_gpioIntrAttach(sim_gpioIsr pIsr, void *pArg);
+void sim_gpioIntrEnable(unsigned char pEnable);
+void gpio_output_set(uint32 set_mask, uint32 clear_mask, uint32 enable_mask, uint32 disable_mask);
+void gpio_pin_intr_state_set(uint32 i, GPIO_INT_TYPE intr_state);
+
+#endif // __gpio_H__
\ No newline at end of file
@@ -0,0 +1,62 @@
+/*
+* ----------------------------------------------------------------------------
+* The MIT License (MIT)
+*
+* Copyright (c) 2016 - Matthias Jentsch
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+* ----------------------------------------------------------------------------
+*/
+
+// minimal replacement of the SDK header osapi.h; used to build the firmware sources on a Linux host (see tools/echosim.c)
+// the timers run on the virtual time of the simulation
+
+#ifndef __osapi_H__
+#define __osapi_H__
+
+#include <string.h>
+#include "c_types.h"
+#include <user_config.h>
+
+// the host has no CPU cycle counter; the echo edges are timestamped with the virtual system time in microseconds
+#undef ULTRASONIC_CCOUNT_CAPTURE
+
+typedef void os_timer_func_t(void *timer_arg);
+
+typedef struct _ETSTIMER_
+{
+	struct _ETSTIMER_ *next;	// next armed timer
+	uint32 due;	// virtual system time in microseconds when the timer elapses
+	uint32 periodMs;	// period of a repeated timer in milliseconds; 0 for a single shot timer
+	os_timer_func_t *func;
+	void *arg;
+} ETSTimer;
+
+#define os_memset memset
+#define os_memcpy memcpy
+#define os_printf sim_printf
+
+// output of the firmware; only printed in verbose mode
+int sim_printf(const char *pFormat, ...);
+
+void os_timer_setfn(ETSTimer *pTimer, os_timer_func_t *pFunction, void *pArg);
+void os_timer_arm(ETSTimer *pTimer, uint32 milliseconds, bool repeatFlag);
+void os_timer_disarm(ETSTimer *pTimer);
+
+#endif // __osapi_H__
\ No newline at end of file
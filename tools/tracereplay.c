@@ -0,0 +1,243 @@
+/*
+* ----------------------------------------------------------------------------
+* The MIT License (MIT)
+*
+* Copyright (c) 2016 - Matthias Jentsch
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+* ----------------------------------------------------------------------------
+*/
+
+// replays the traces of the ultrasonic meter (see ULTRASONIC_TRACE) on a Linux host
+// the echo times of every trace are converted to distances like the firmware does and fed into all estimators
+// the output is one tab separated line per trace, channel and estimator; so the results of two builds can be compared with diff
+//
+// build (from the repository root):
+//   gcc -std=c99 -O2 -Itools/host -Iinclude -o tracereplay tools/tracereplay.c user/estimator.c
+// usage:
+//   ./tracereplay [-v] [-n <repetitions>] <trace file> ...
+// a trace file is either the raw binary trace or the hex string of the "Trace" value of the ReadTrace response
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include "c_types.h"
+#include <ultrasonicmeter.h>
+#include <estimator.h>
+#include <trace.h>
+
+// Unit of measurement according to the datashett of HC-SR04; the same as in user/ultrasonicmeter.c
+#define US_PER_CM 58
+// count of estimators; see estimator.h
+#define ESTIMATOR_COUNT 4
+
+// names of the estimators
+static const char *tracereplay_estimatorNames[ESTIMATOR_COUNT] = { "trimmed-mean", "median", "hampel-mean", "interquartile-mean" };
+
+// the distances of one channel reconstructed from a trace
+typedef struct
+{
+	sint32 distances[ESTIMATOR_MAX_VALUES];	// the distances in 1/DISTANCE_UNITS_PER_MM mm; -1 if the value is invalid
+	unsigned char count;	// count of distances
+	unsigned char shots;	// count of fired shots
+	unsigned char lost;	// count of shots without an echo
+} ChannelReplay;
+
+// reads a trace file; binary or hex string; returns FALSE if the file can't be read
+static int tracereplay_readFile(const char *pFileName, Trace *pTrace)
+{
+	unsigned char buffer[2 * sizeof(Trace) + 16];
+	FILE *file = fopen(pFileName, "rb");
+	if (file == NULL)
+	{
+		return FALSE;
+	}
+	size_t size = fread(buffer, 1, sizeof(buffer), file);
+	fclose(file);
+
+	memset(pTrace, 0, sizeof(Trace));
+	// a hex string contains only hex digits, white spaces and maybe the quotes of the JSON string
+	int isHex = size > 0;
+	for (size_t i = 0; i < size; i++)
+	{
+		if (!isxdigit(buffer[i]) && !isspace(buffer[i]) && buffer[i] != '"')
+		{
+			isHex = FALSE;
+			break;
+		}
+	}
+	if (isHex)
+	{
+		unsigned char *trace = (unsigned char*)pTrace;
+		size_t traceSize = 0;
+		int high = -1;
+		for (size_t i = 0; i < size && traceSize < sizeof(Trace); i++)
+		{
+			if (!isxdigit(buffer[i]))
+			{
+				continue;
+			}
+			int nibble = isdigit(buffer[i]) ? buffer[i] - '0' : tolower(buffer[i]) - 'a' + 10;
+			if (high < 0)
+			{
+				high = nibble;
+			}
+			else
+			{
+				trace[traceSize++] = (unsigned char)(high << 4 | nibble);
+				high = -1;
+			}
+		}
+	}
+	else
+	{
+		memcpy(pTrace, buffer, size < sizeof(Trace) ? size : sizeof(Trace));
+	}
+	return pTrace->header.magic == TRACE_MAGIC && pTrace->header.version == TRACE_VERSION &&
+		pTrace->header.recordCount <= TRACE_MAX_RECORDS && pTrace->header.channelCount <= TRACE_MAX_CHANNELS &&
+		pTrace->header.ticksPerUs > 0;
+}
+
+// converts the echo times of the trace into distances; the same calculation as in ultrasonicMeter_storeDistance
+static void tracereplay_reconstruct(const Trace *pTrace, ChannelReplay *pChannels, int pVerbose)
+{
+	uint32 startTime[TRACE_MAX_CHANNELS] = { 0 };
+	int hasStartTime[TRACE_MAX_CHANNELS] = { FALSE };
+	uint32 ticksPerCm = pTrace->header.ticksPerUs * US_PER_CM;
+
+	memset(pChannels, 0, sizeof(ChannelReplay) * TRACE_MAX_CHANNELS);
+	for (int i = 0; i < pTrace->header.recordCount; i++)
+	{
+		const TraceRecord *record = &pTrace->records[i];
+		if (record->channel >= TRACE_MAX_CHANNELS)
+		{
+			continue;
+		}
+		ChannelReplay *channel = &pChannels[record->channel];
+		switch (record->type)
+		{
+		case TRACE_TRIGGER:
+			channel->shots++;
+			hasStartTime[record->channel] = FALSE;
+			break;
+
+		case TRACE_RISING_EDGE:
+			startTime[record->channel] = record->timestamp;
+			hasStartTime[record->channel] = TRUE;
+			break;
+
+		case TRACE_FALLING_EDGE:
+			if (hasStartTime[record->channel] == TRUE && channel->count < ESTIMATOR_MAX_VALUES)
+			{
+				uint32 ticks = record->timestamp - startTime[record->channel];
+				sint32 distance = (sint32)((ticks / ticksPerCm) * 10 * DISTANCE_UNITS_PER_MM + (ticks % ticksPerCm) * 10 * DISTANCE_UNITS_PER_MM / ticksPerCm);
+				if (distance > (sint32)pTrace->header.distanceEmpty[record->channel] * DISTANCE_UNITS_PER_MM)
+				{
+					distance = -1;
+				}
+				channel->distances[channel->count++] = distance;
+				if (pVerbose)
+				{
+					printf("# channel %d: distance = %d/%d mm\n", record->channel, (int)distance, DISTANCE_UNITS_PER_MM);
+				}
+			}
+			hasStartTime[record->channel] = FALSE;
+			break;
+
+		case TRACE_TIMEOUT:
+			channel->lost++;
+			hasStartTime[record->channel] = FALSE;
+			break;
+		}
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	int verbose = FALSE;
+	long repetitions = 0;
+	int firstFile = 1;
+	Trace trace;
+	ChannelReplay channels[TRACE_MAX_CHANNELS];
+
+	// options
+	while (firstFile < argc && argv[firstFile][0] == '-')
+	{
+		if (strcmp(argv[firstFile], "-v") == 0)
+		{
+			verbose = TRUE;
+		}
+		else if (strcmp(argv[firstFile], "-n") == 0 && firstFile + 1 < argc)
+		{
+			repetitions = atol(argv[++firstFile]);
+		}
+		else
+		{
+			break;
+		}
+		firstFile++;
+	}
+	if (firstFile >= argc)
+	{
+		fprintf(stderr, "usage: %s [-v] [-n <repetitions>] <trace file> ...\n", argv[0]);
+		return 2;
+	}
+
+	printf("# file\tchannel\tshots\tvalid\tlost\testimator\tlevel\tdispersion\n");
+	int result = 0;
+	for (int f = firstFile; f < argc; f++)
+	{
+		if (tracereplay_readFile(argv[f], &trace) == FALSE)
+		{
+			fprintf(stderr, "%s: no valid trace\n", argv[f]);
+			result = 1;
+			continue;
+		}
+		tracereplay_reconstruct(&trace, channels, verbose);
+		for (int c = 0; c < trace.header.channelCount; c++)
+		{
+			ChannelReplay *channel = &channels[c];
+			for (int e = 0; e < ESTIMATOR_COUNT; e++)
+			{
+				sint32 distance;
+				sint32 dispersion;
+				unsigned char valid = estimator_estimate(e, channel->distances, channel->count, &distance, &dispersion);
+				// the water level like the firmware calculates it
+				sint32 waterLevel = valid > 0 ? (sint32)trace.header.distanceEmpty[c] * DISTANCE_UNITS_PER_MM - distance : 0;
+				printf("%s\t%d\t%d\t%d\t%d\t%s%s\t%d\t%d\n", argv[f], c, channel->shots, valid, channel->lost,
+					tracereplay_estimatorNames[e], e == trace.header.estimator ? "*" : "", (int)waterLevel, (int)dispersion);
+
+				// benchmark the estimator
+				if (repetitions > 0)
+				{
+					clock_t start = clock();
+					for (long r = 0; r < repetitions; r++)
+					{
+						estimator_estimate(e, channel->distances, channel->count, &distance, &dispersion);
+					}
+					double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+					printf("# %s: %.1f ns per call\n", tracereplay_estimatorNames[e], seconds * 1e9 / repetitions);
+				}
+			}
+		}
+	}
+	return result;
+}
\ No newline at end of file
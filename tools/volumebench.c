@@ -0,0 +1,248 @@
+/*
+* ----------------------------------------------------------------------------
+* The MIT License (MIT)
+*
+* Copyright (c) 2016 - Matthias Jentsch
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+* ----------------------------------------------------------------------------
+*/
+
+// compares the volume table of a cistern (see volumetable.h) with the closed form in float like the firmware calculates it on a Linux host
+// for every radius the table is built like on the first lookup of a wake up and evaluated at every 1/DISTANCE_UNITS_PER_MM mm water level
+// from the bottom to the top; the output is one tab separated line per radius with the errors, the time per evaluation and the time
+// to build the table (the firmware builds the table into RAM once per wake up that needs the water content)
+// the times are only a relative measure; the ESP8266 has no floating point unit and is much slower with the closed form
+// the other dimensions of the cistern types follow from the radius: the rectangular cistern is 2 * radius high and wide,
+// the truncated cone is 2 * radius high with half the radius at the top and the ends of the domed cylinder are radius / 2 deep
+//
+// build (from the repository root):
+//   gcc -std=c99 -O2 -Itools/host -Iinclude -o volumebench tools/volumebench.c user/volumetable.c -lm
+// usage:
+//   ./volumebench [-s <cistern type 1, 4, 5, 6 or 7>] [-l <cistern length mm>] [-t <max error in percent of the full cistern>] [<radius mm> ...]
+// the exit status is 1 if the error of a table exceeds the -t limit
+
+#define M_PI 3.14159265358979323846
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <math.h>
+#include <time.h>
+#include "c_types.h"
+#include "osapi.h"
+#include "user_interface.h"
+#include <ultrasonicmeter.h>
+#include <configuration.h>
+#include <volumetable.h>
+
+// the radiuses in millimeters if none are given
+static const unsigned int volumebench_defaultRadiuses[] = { 100, 250, 500, 750, 1000, 1250, 1500, 2000, 2500 };
+
+// the cistern parameters of the current run
+static unsigned char volumebench_type = 1;
+static unsigned int volumebench_radius;
+static unsigned int volumebench_length = 2000;
+
+// the water content in liters like the firmware calculates it in float; pWaterLevel in mm
+static float volumebench_closedForm(float pWaterLevel)
+{
+	float radius = (float)volumebench_radius;
+	float rMinusH = radius - pWaterLevel;
+	float segment = radius * radius * acosf(rMinusH / radius) - rMinusH * sqrtf(2.0 * radius * pWaterLevel - pWaterLevel * pWaterLevel);
+	float cap = (float)M_PI * pWaterLevel * pWaterLevel * (3.0 * radius - pWaterLevel) / 3.0;
+	float levelRadius = radius + (radius / 2 - radius) * pWaterLevel / (2 * radius);
+	switch (volumebench_type)
+	{
+	case 4:
+		return cap / 1000000.0;
+	case 5:
+		return (float)volumebench_length * 2 * radius * pWaterLevel / 1000000.0;
+	case 6:
+		return (float)M_PI * pWaterLevel * (radius * radius + radius * levelRadius + levelRadius * levelRadius) / 3.0 / 1000000.0;
+	case 7:
+		return (segment * volumebench_length + cap / 2) / 1000000.0;
+	default:
+		return segment * volumebench_length / 1000000.0;
+	}
+}
+
+// the exact water content in liters; pWaterLevel in mm
+static double volumebench_exact(double pWaterLevel)
+{
+	double radius = volumebench_radius;
+	double rMinusH = radius - pWaterLevel;
+	double segment = radius * radius * acos(rMinusH / radius) - rMinusH * sqrt(2.0 * radius * pWaterLevel - pWaterLevel * pWaterLevel);
+	double cap = M_PI * pWaterLevel * pWaterLevel * (3.0 * radius - pWaterLevel) / 3.0;
+	double levelRadius = radius - radius / 2 * pWaterLevel / (2 * radius);
+	switch (volumebench_type)
+	{
+	case 4:
+		return cap / 1000000.0;
+	case 5:
+		return volumebench_length * 2 * radius * pWaterLevel / 1000000.0;
+	case 6:
+		return M_PI * pWaterLevel * (radius * radius + radius * levelRadius + levelRadius * levelRadius) / 3.0 / 1000000.0;
+	case 7:
+		return (segment * volumebench_length + cap / 2) / 1000000.0;
+	default:
+		return segment * volumebench_length / 1000000.0;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	double maxErrorPercent = -1;
+	int arg = 1;
+
+	// options
+	while (arg + 1 < argc && argv[arg][0] == '-')
+	{
+		if (strcmp(argv[arg], "-s") == 0)
+		{
+			volumebench_type = (unsigned char)atoi(argv[arg + 1]);
+		}
+		else if (strcmp(argv[arg], "-l") == 0)
+		{
+			volumebench_length = (unsigned int)atoi(argv[arg + 1]);
+		}
+		else if (strcmp(argv[arg], "-t") == 0)
+		{
+			maxErrorPercent = atof(argv[arg + 1]);
+		}
+		else
+		{
+			break;
+		}
+		arg += 2;
+	}
+	if ((arg < argc && argv[arg][0] == '-') || volumebench_length == 0 ||
+		(volumebench_type != 1 && (volumebench_type < 4 || volumebench_type > 7)))
+	{
+		fprintf(stderr, "usage: %s [-s <cistern type 1, 4, 5, 6 or 7>] [-l <cistern length mm>] [-t <max error in percent of the full cistern>] [<radius mm> ...]\n", argv[0]);
+		return 2;
+	}
+	int radiusCount = arg < argc ? argc - arg : (int)(sizeof(volumebench_defaultRadiuses) / sizeof(volumebench_defaultRadiuses[0]));
+
+	printf("# type %u; length %u mm; %d segments\n", volumebench_type, volumebench_length, VOLUME_TABLE_SEGMENTS);
+	printf("# radius\tliters-full\tmax-error-table\tmax-error-closed-form\tmax-error-percent\trms-error-table\tns-table\tns-closed-form\tus-build-table\n");
+	int result = 0;
+	for (int r = 0; r < radiusCount; r++)
+	{
+		volumebench_radius = arg < argc ? (unsigned int)atoi(argv[arg + r]) : volumebench_defaultRadiuses[r];
+		if (volumebench_radius == 0)
+		{
+			continue;
+		}
+		// the time to build the table; like the first lookup of a wake up
+		clock_t start = clock();
+		for (int repetition = 0; repetition < 10; repetition++)
+		{
+			volumetable_build();
+		}
+		double usBuild = (double)(clock() - start) / CLOCKS_PER_SEC * 1e6 / 10.0;
+
+		// the errors against the exact value at every water level; all cistern types are 2 * radius high
+		sint32 diameter = 2 * volumebench_radius * DISTANCE_UNITS_PER_MM;
+		double maxErrorTable = 0;
+		double maxErrorClosedForm = 0;
+		double sumSquaredError = 0;
+		for (sint32 level = 0; level <= diameter; level++)
+		{
+			uint32 milliliters;
+			if (volumetable_getMilliliters(0, level, &milliliters) == FALSE)
+			{
+				fprintf(stderr, "radius %u: no volume table\n", volumebench_radius);
+				return 1;
+			}
+			double exact = volumebench_exact((double)level / DISTANCE_UNITS_PER_MM);
+			double errorTable = fabs(milliliters / 1000.0 - exact);
+			double errorClosedForm = fabs(volumebench_closedForm((float)level / DISTANCE_UNITS_PER_MM) - exact);
+			// acosf delivers NaN for rounding errors at the top
+			if (errorClosedForm != errorClosedForm)
+			{
+				errorClosedForm = exact;
+			}
+			sumSquaredError += errorTable * errorTable;
+			maxErrorTable = errorTable > maxErrorTable ? errorTable : maxErrorTable;
+			maxErrorClosedForm = errorClosedForm > maxErrorClosedForm ? errorClosedForm : maxErrorClosedForm;
+		}
+		double full = volumebench_exact(2.0 * volumebench_radius);
+		double errorPercent = maxErrorTable / full * 100.0;
+
+		// the time per evaluation; the results are summed up so the compiler can't drop the calls
+		volatile double sum = 0;
+		start = clock();
+		for (int repetition = 0; repetition < 10; repetition++)
+		{
+			for (sint32 level = 0; level <= diameter; level++)
+			{
+				uint32 milliliters;
+				volumetable_getMilliliters(0, level, &milliliters);
+				sum += milliliters;
+			}
+		}
+		double nsTable = (double)(clock() - start) / CLOCKS_PER_SEC * 1e9 / (10.0 * (diameter + 1));
+		start = clock();
+		for (int repetition = 0; repetition < 10; repetition++)
+		{
+			for (sint32 level = 0; level <= diameter; level++)
+			{
+				sum += volumebench_closedForm((float)level / DISTANCE_UNITS_PER_MM);
+			}
+		}
+		double nsClosedForm = (double)(clock() - start) / CLOCKS_PER_SEC * 1e9 / (10.0 * (diameter + 1));
+
+		printf("%u\t%.1f\t%.3f\t%.3f\t%.4f\t%.3f\t%.1f\t%.1f\t%.1f\n", volumebench_radius, full, maxErrorTable, maxErrorClosedForm, errorPercent,
+			sqrt(sumSquaredError / (diameter + 1)), nsTable, nsClosedForm, usBuild);
+		if (maxErrorPercent >= 0 && errorPercent > maxErrorPercent)
+		{
+			fprintf(stderr, "radius %u: error %.4f %% exceeds %.4f %%\n", volumebench_radius, errorPercent, maxErrorPercent);
+			result = 1;
+		}
+	}
+	return result;
+}
+
+// the simulated SDK and the configuration that user/volumetable.c uses; see the headers in tools/host
+
+int sim_printf(const char *pFormat, ...)
+{
+	return 0;
+}
+
+void ICACHE_FLASH_ATTR configuration_getCisternParameters(unsigned char channel, unsigned char *cisternType, unsigned int *cisternRadius,
+	unsigned int *cisternLength, unsigned int *distanceEmpty, unsigned int *litersFull)
+{
+	*cisternType = volumebench_type;
+	*cisternRadius = volumebench_radius;
+	*cisternLength = volumebench_length;
+	*distanceEmpty = 2 * volumebench_radius;
+	*litersFull = (unsigned int)volumebench_exact(2.0 * volumebench_radius);
+}
+
+void ICACHE_FLASH_ATTR configuration_getCisternShape(unsigned char channel, unsigned int *cisternWidth, unsigned int *cisternHeight,
+	unsigned int *cisternTopRadius, unsigned int *cisternDomeDepth)
+{
+	*cisternWidth = 2 * volumebench_radius;
+	*cisternHeight = 2 * volumebench_radius;
+	*cisternTopRadius = volumebench_radius / 2;
+	*cisternDomeDepth = volumebench_radius / 2;
+}
\ No newline at end of file
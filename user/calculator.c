@@ -27,20 +27,27 @@
 #define M_PI 3.14159265358979323846
 
 #include "c_types.h"
+#include "osapi.h"
 #include <espmissingincludes.h>
 #include <configuration.h>
+#include <ultrasonicmeter.h>
+#include <volumetable.h>
+#include <strappingtable.h>
+#include <calculator.h>
 
-// the last measured water level in millimeters
-static float calculator_lastWaterLevel = 0.0;
-// the last calculated wasser content in liters
-static float calculator_liter = 0.0;
-// the last calculated water level in centimeters
-static float calculator_centimeter = 0.0;
-// the last calculated water content in percent
-static float calculator_percent = 0.0;
+// the last measured water level per ultrasonic sensor channel in 1/DISTANCE_UNITS_PER_MM mm
+static sint32 calculator_lastWaterLevel[ULTRASONIC_CHANNEL_COUNT];
+// the last calculated wasser content per ultrasonic sensor channel in liters
+static float calculator_liter[ULTRASONIC_CHANNEL_COUNT];
+// the last calculated water level per ultrasonic sensor channel in centimeters
+static float calculator_centimeter[ULTRASONIC_CHANNEL_COUNT];
+// the last calculated water content per ultrasonic sensor channel in percent
+static float calculator_percent[ULTRASONIC_CHANNEL_COUNT];
+// per ultrasonic sensor channel TRUE if the water content could be calculated
+static unsigned char calculator_isContentValid[ULTRASONIC_CHANNEL_COUNT];
 
-// function calculates new values from the given water level in millimeters
-void ICACHE_FLASH_ATTR calculator_calculateNewValues(float waterLevel)
+// function calculates new values for the cistern of the ultrasonic sensor channel from the given water level in 1/DISTANCE_UNITS_PER_MM mm
+void ICACHE_FLASH_ATTR calculator_calculateNewValues(unsigned char channel, sint32 fixedPointWaterLevel)
 {
 	float rMinusH;
 	float radiusSquare;
@@ -50,26 +57,37 @@ void ICACHE_FLASH_ATTR calculator_calculateNewValues(float waterLevel)
 	unsigned int cisternLength;
 	unsigned int distanceEmpty;
 	unsigned int litersFull;
+	uint32 milliliters;
 
 	// Water level unchanged?
-	if (calculator_lastWaterLevel == waterLevel)
+	if (calculator_lastWaterLevel[channel] == fixedPointWaterLevel)
 	{
 		// nothing to do
 		return;
 	}
+	calculator_lastWaterLevel[channel] = fixedPointWaterLevel;
+	// the water level in millimeters; from here on the values are only used for formatting
+	float waterLevel = (float)fixedPointWaterLevel / (float)DISTANCE_UNITS_PER_MM;
 
 	// get the cistern parameters
-	configuration_getCisternParameters(&cisternType, &cisternRadius, &cisternLength, &distanceEmpty, &litersFull);
+	configuration_getCisternParameters(channel, &cisternType, &cisternRadius, &cisternLength, &distanceEmpty, &litersFull);
 
+	calculator_isContentValid[channel] = TRUE;
 	switch (cisternType)
 	{
 		// the cistern is a horizontal cylinder
 	case 1:
+		// the table built with the configuration avoids the soft-float acosf and sqrtf
+		if (volumetable_getMilliliters(channel, fixedPointWaterLevel, &milliliters) == TRUE)
+		{
+			calculator_liter[channel] = (float)milliliters / 1000.0;
+			break;
+		}
 		rMinusH = (float)cisternRadius - waterLevel;
 		radiusSquare = ((float)cisternRadius * (float)cisternRadius);
 		diameter = 2.0 * (float)cisternRadius;
 		// calculate the liters. The cistern is aproximated by a horizontal cylinder
-		calculator_liter = radiusSquare * cisternLength *
+		calculator_liter[channel] = radiusSquare * cisternLength *
 			(acosf(rMinusH / cisternRadius)
 				- rMinusH * sqrtf(diameter * waterLevel - waterLevel * waterLevel) / radiusSquare)
 			/ 1000000.0;
@@ -79,34 +97,66 @@ void ICACHE_FLASH_ATTR calculator_calculateNewValues(float waterLevel)
 	case 2:
 		radiusSquare = ((float)cisternRadius * (float)cisternRadius);
 		// calculate the liters. The cistern is aproximated by a vertical cylinder
-		calculator_liter = M_PI * radiusSquare * waterLevel / 1000000.0;
+		calculator_liter[channel] = M_PI * radiusSquare * waterLevel / 1000000.0;
 		break;
 
+		// the cistern has an irregular shape; the content is interpolated from the strapping table
+	case 3:
+		if (strappingtable_getMilliliters(channel, fixedPointWaterLevel, &milliliters) == FALSE)
+		{
+			// the configuration is only saved with a table; so the saved table is damaged
+			os_printf("Calculator: no strapping table for channel %d\n", channel);
+			calculator_isContentValid[channel] = FALSE;
+			break;
+		}
+		calculator_liter[channel] = (float)milliliters / 1000.0;
+		break;
+
+		// sphere, rectangular, truncated cone and horizontal cylinder with domed ends; the closed forms only run when the configuration is saved
 	default:
-		calculator_liter = 0;
+		if (volumetable_getMilliliters(channel, fixedPointWaterLevel, &milliliters) == FALSE)
+		{
+			// the cistern parameters don't describe a cistern of the type; an empty cistern would be a wrong value
+			os_printf("Calculator: no volume table for the cistern type %d of channel %d\n", cisternType, channel);
+			calculator_isContentValid[channel] = FALSE;
+			break;
+		}
+		calculator_liter[channel] = (float)milliliters / 1000.0;
 	}
 			
 	// The water level in centimeter is easy to calculate
-	calculator_centimeter = waterLevel / 10.0;
+	calculator_centimeter[channel] = waterLevel / 10.0;
 	
 	// calculate the content level in percent
-	calculator_percent = calculator_liter / (float)litersFull * 100.0;
+	if (calculator_isContentValid[channel] == FALSE)
+	{
+		calculator_liter[channel] = CALCULATOR_CONTENT_INVALID;
+		calculator_percent[channel] = CALCULATOR_CONTENT_INVALID;
+		return;
+	}
+	calculator_percent[channel] = calculator_liter[channel] / (float)litersFull * 100.0;
 }  
 
-// returns the last calculated wasser content in liters
-float ICACHE_FLASH_ATTR calculator_getLiter()
+// returns TRUE if the water content of the cistern of the ultrasonic sensor channel could be calculated
+unsigned char ICACHE_FLASH_ATTR calculator_isContentCalculated(unsigned char channel)
+{
+	return calculator_isContentValid[channel];
+}
+
+// returns the last calculated wasser content in liters of the cistern of the ultrasonic sensor channel
+float ICACHE_FLASH_ATTR calculator_getLiter(unsigned char channel)
 {
-	return calculator_liter;
+	return calculator_liter[channel];
 }
 
-// returns the last calculated water level in centimeters
-float ICACHE_FLASH_ATTR calculator_getCentimeter()
+// returns the last calculated water level in centimeters of the cistern of the ultrasonic sensor channel
+float ICACHE_FLASH_ATTR calculator_getCentimeter(unsigned char channel)
 {
-	return calculator_centimeter;
+	return calculator_centimeter[channel];
 }
 
-// returns the last calculated water content in percent
-float ICACHE_FLASH_ATTR calculator_getPercent()
+// returns the last calculated water content in percent of the cistern of the ultrasonic sensor channel
+float ICACHE_FLASH_ATTR calculator_getPercent(unsigned char channel)
 {
-	return calculator_percent;
+	return calculator_percent[channel];
 }
\ No newline at end of file
@@ -33,26 +33,48 @@
 #include "jsonparse.h"
 #include <espmissingincludes.h>
 #include <io.h>
-#include <powermanagement.h>
 #include <ultrasonicmeter.h>
+#include <powermanagement.h>
+#include <estimator.h>
 #include <cJSON.h>
+#include <trace.h>
+#include <strappingtable.h>
 #include <configuration.h>
 
+// pause between two streamed measurements in milliseconds; see StreamMeasurements
+#define STREAM_PERIOD_MS 100
+// the filtered distance of the streamed measurements is estimated from this count of the last single shot distances (see ULTRASONIC_ESTIMATOR)
+#define STREAM_WINDOW_SIZE 5
+// max count of strapping table points per ReadStrappingTable response; the response must fit into one tcp packet
+#define STRAPPING_TABLE_POINTS_PER_RESPONSE 32
+
+// parameters of one cistern; there is one cistern per ultrasonic sensor channel
+typedef struct
+{
+	unsigned char cisternType;	// cistern type; 1 = horizontal cylinder; 2 = vertical cylinder; 3 = strapping table (see WriteStrappingTable); 4 = sphere;
+								// 5 = rectangular; 6 = vertical truncated cone; 7 = horizontal cylinder with ellipsoidal ends
+	unsigned int cisternRadius; // cistern radius in millimeters only for the type 1, 2, 4, 6 (bottom radius) and 7 cisterns needed
+	unsigned int cisternLength; // cistern length in millimeters only for the type 1, 5 and 7 (without the ends) cisterns needed
+	unsigned int cisternWidth; // cistern width in millimeters only for the type 5 cistern needed
+	unsigned int cisternHeight; // cistern height in millimeters only for the type 5 and 6 cisterns needed
+	unsigned int cisternTopRadius; // top radius in millimeters only for the type 6 cistern needed
+	unsigned int cisternDomeDepth; // depth of each end in millimeters only for the type 7 cistern needed; the radius for hemispherical ends
+	unsigned int distanceEmpty; // Distance in millimeters water to ultrasonic sensor if the cistern is empty
+	unsigned int litersFull; // Liters if the cistern is full and flooding
+} CisternParameters;
+
 // configuration data that will be stored into flash memory (4KB max)
 typedef struct
 {
 	unsigned char version; // if not CONFIGURATION_DATA_VERSION then the data in the struct is not valid
 	char wifiSsid[32]; // WiFi network name (SSID)
 	char wifiPassword[64]; // WiFi password
-	unsigned char cisternType;	// cistern type; 1 = horizontal cylinder; 2 = vertical cylinder
-	unsigned int cisternRadius; // cistern radius in millimeters
-	unsigned int cisternLength; // cistern length in millimeters only for the type 1 cistern needed
-	unsigned int distanceEmpty; // Distance in millimeters water to ultrasonic sensor if the cistern is empty
-	unsigned int litersFull; // Liters if the cistern is full and flooding
+	CisternParameters cisterns[ULTRASONIC_CHANNEL_COUNT]; // the cisterns; one per ultrasonic sensor channel
 	char hostname[256];	// the ESP8266 set this hostname after a connection to the access point is established
 	unsigned short deepSleepPeriod;	// the deep sleep period in seconds
 	unsigned short minDifferenceToPost; // if the difference between the last measurement and the current measurement is greater than this value in mm the data should be posted to the internet immediately
 	unsigned short maxDataAgeToPost; // after this max count of deep sleep cycles also an unchanged measurement will be postet
+	unsigned short continuousPeriod; // measurement period in milliseconds of the continuous mode for mains-powered installations; 0 = deep sleep mode
 	unsigned char shouldPostToThingspeak; // if TRUE the data should be posted to a Thingspeak server
 	char thingspeakServerUrl[256]; // Thingspeak server URL
 	char thingspeakApiKey[32]; // API key for Thingspeak
@@ -76,6 +98,136 @@ static ConfigurationData configuration_data;
 static struct espconn configuration_socketConnection;
 // the tcp connection for receiving the configuration data
 static esp_tcp configuration_tcpConnection;
+// TRUE while the measurements are streamed; the connection is kept open until the streaming is stopped
+static unsigned char configuration_isStreaming = FALSE;
+// the timer for the pause between two streamed measurements
+static ETSTimer configuration_streamTimer;
+// the last single shot distances of the streamed measurements per channel in 1/DISTANCE_UNITS_PER_MM mm; -1 if invalid
+static sint32 configuration_streamDistances[ULTRASONIC_CHANNEL_COUNT][STREAM_WINDOW_SIZE];
+// the index in configuration_streamDistances for the next measurement
+static unsigned char configuration_streamIndex = 0;
+
+// called after a streamed single shot measurement is finished
+static void ICACHE_FLASH_ATTR configuration_sendStreamedMeasurement();
+
+// reads the parameters of one cistern from the received json data; returns TRUE if the parameters are valid
+static bool ICACHE_FLASH_ATTR configuration_parseCistern(cJSON *pCisternData, CisternParameters *pCistern)
+{
+	pCistern->cisternType = (unsigned char)cJSON_GetObjectItem(pCisternData, "CisternType")->valueint;
+	pCistern->cisternRadius = (unsigned int)cJSON_GetObjectItem(pCisternData, "CisternRadius")->valueint;
+	pCistern->cisternLength = (unsigned int)cJSON_GetObjectItem(pCisternData, "CisternLength")->valueint;
+	pCistern->distanceEmpty = (unsigned int)cJSON_GetObjectItem(pCisternData, "DistanceEmpty")->valueint;
+	pCistern->litersFull = (unsigned int)cJSON_GetObjectItem(pCisternData, "LitersFull")->valueint;
+	// optional; only needed for the types 5 to 7
+	cJSON *item = cJSON_GetObjectItem(pCisternData, "CisternWidth");
+	pCistern->cisternWidth = item != NULL ? (unsigned int)item->valueint : 0;
+	item = cJSON_GetObjectItem(pCisternData, "CisternHeight");
+	pCistern->cisternHeight = item != NULL ? (unsigned int)item->valueint : 0;
+	item = cJSON_GetObjectItem(pCisternData, "CisternTopRadius");
+	pCistern->cisternTopRadius = item != NULL ? (unsigned int)item->valueint : 0;
+	item = cJSON_GetObjectItem(pCisternData, "CisternDomeDepth");
+	pCistern->cisternDomeDepth = item != NULL ? (unsigned int)item->valueint : 0;
+	if (pCistern->distanceEmpty == 0 || pCistern->litersFull == 0)
+	{
+		return FALSE;
+	}
+	switch (pCistern->cisternType)
+	{
+	case 1:
+		return pCistern->cisternRadius > 0 && pCistern->cisternLength > 0;
+	case 2:
+	case 4:
+		return pCistern->cisternRadius > 0;
+		// the strapping table of the type 3 cistern is written with its own command
+	case 3:
+		return TRUE;
+	case 5:
+		return pCistern->cisternLength > 0 && pCistern->cisternWidth > 0 && pCistern->cisternHeight > 0;
+		// a top or bottom radius of 0 is a cone
+	case 6:
+		return (pCistern->cisternRadius > 0 || pCistern->cisternTopRadius > 0) && pCistern->cisternHeight > 0;
+	case 7:
+		return pCistern->cisternRadius > 0 && pCistern->cisternDomeDepth > 0 && pCistern->cisternDomeDepth <= pCistern->cisternRadius;
+	default:
+		return FALSE;
+	}
+}
+
+// adds the parameters of one cistern to the json data
+static void ICACHE_FLASH_ATTR configuration_addCistern(cJSON *pCisternData, CisternParameters *pCistern)
+{
+	cJSON_AddNumberToObject(pCisternData, "CisternType", pCistern->cisternType);
+	cJSON_AddNumberToObject(pCisternData, "CisternRadius", pCistern->cisternRadius);
+	cJSON_AddNumberToObject(pCisternData, "CisternLength", pCistern->cisternLength);
+	cJSON_AddNumberToObject(pCisternData, "DistanceEmpty", pCistern->distanceEmpty);
+	cJSON_AddNumberToObject(pCisternData, "LitersFull", pCistern->litersFull);
+	cJSON_AddNumberToObject(pCisternData, "CisternWidth", pCistern->cisternWidth);
+	cJSON_AddNumberToObject(pCisternData, "CisternHeight", pCistern->cisternHeight);
+	cJSON_AddNumberToObject(pCisternData, "CisternTopRadius", pCistern->cisternTopRadius);
+	cJSON_AddNumberToObject(pCisternData, "CisternDomeDepth", pCistern->cisternDomeDepth);
+}
+
+// sets the received points of the strapping table of one cistern; the whole table doesn't fit into one tcp packet
+// so it is written in parts: {"Cistern": <channel>, "Index": <index of the first point>, "Points": [[<level in mm>, <liters>], ...]}
+// returns TRUE if all points are valid
+static bool ICACHE_FLASH_ATTR configuration_parseStrappingTable(cJSON *pTableData)
+{
+	cJSON *cisternItem = cJSON_GetObjectItem(pTableData, "Cistern");
+	cJSON *indexItem = cJSON_GetObjectItem(pTableData, "Index");
+	cJSON *points = cJSON_GetObjectItem(pTableData, "Points");
+	if (cisternItem == NULL || indexItem == NULL || points == NULL || points->type != cJSON_Array ||
+		cisternItem->valueint < 0 || cisternItem->valueint >= ULTRASONIC_CHANNEL_COUNT || indexItem->valueint < 0)
+	{
+		return FALSE;
+	}
+	int size = cJSON_GetArraySize(points);
+	for (int i = 0; i < size; i++)
+	{
+		cJSON *point = cJSON_GetArrayItem(points, i);
+		if (point->type != cJSON_Array || cJSON_GetArraySize(point) != 2)
+		{
+			return FALSE;
+		}
+		int level = cJSON_GetArrayItem(point, 0)->valueint;
+		double liters = cJSON_GetArrayItem(point, 1)->valuedouble;
+		if (level < 0 || level > 0xFFFF || liters < 0 || liters > 4000000.0 ||
+			strappingtable_setPoint(cisternItem->valueint, indexItem->valueint + i, level, (uint32)(liters * 1000.0 + 0.5)) == FALSE)
+		{
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+// adds a part of the strapping table of one cistern to the response; the counterpart of configuration_parseStrappingTable
+static void ICACHE_FLASH_ATTR configuration_addStrappingTable(cJSON *pTableData, cJSON *pResponse, cJSON *pData)
+{
+	cJSON *cisternItem = cJSON_GetObjectItem(pTableData, "Cistern");
+	cJSON *indexItem = cJSON_GetObjectItem(pTableData, "Index");
+	if (cisternItem == NULL || indexItem == NULL ||
+		cisternItem->valueint < 0 || cisternItem->valueint >= ULTRASONIC_CHANNEL_COUNT || indexItem->valueint < 0)
+	{
+		cJSON_AddNumberToObject(pResponse, "ResponseCode", -1);
+		return;
+	}
+	unsigned short pointCount = strappingtable_getPointCount(cisternItem->valueint);
+	cJSON *points = cJSON_CreateArray();
+	for (int i = indexItem->valueint; i < pointCount && i < indexItem->valueint + STRAPPING_TABLE_POINTS_PER_RESPONSE; i++)
+	{
+		unsigned short level;
+		uint32 milliliters;
+		strappingtable_getPoint(cisternItem->valueint, i, &level, &milliliters);
+		cJSON *point = cJSON_CreateArray();
+		cJSON_AddItemToArray(point, cJSON_CreateNumber(level));
+		cJSON_AddItemToArray(point, cJSON_CreateNumber(milliliters / 1000.0));
+		cJSON_AddItemToArray(points, point);
+	}
+	cJSON_AddNumberToObject(pResponse, "ResponseCode", 9);
+	cJSON_AddNumberToObject(pData, "Cistern", cisternItem->valueint);
+	cJSON_AddNumberToObject(pData, "Index", indexItem->valueint);
+	cJSON_AddNumberToObject(pData, "PointCount", pointCount);
+	cJSON_AddItemToObject(pData, "Points", points);
+}
 
 // will be called after data was received via the tcp server connection
 static bool ICACHE_FLASH_ATTR configuration_parseData(cJSON *pConfigurationData)
@@ -83,15 +235,26 @@ static bool ICACHE_FLASH_ATTR configuration_parseData(cJSON *pConfigurationData)
 	os_printf("Data received ...\n");
 	char *ssid = cJSON_GetObjectItem(pConfigurationData, "SSID")->valuestring;
 	char *password = cJSON_GetObjectItem(pConfigurationData, "Password")->valuestring;
-	unsigned char cisternType = (unsigned char)cJSON_GetObjectItem(pConfigurationData, "CisternType")->valueint;
-	unsigned int cisternRadius = (unsigned int)cJSON_GetObjectItem(pConfigurationData, "CisternRadius")->valueint;
-	unsigned int cisternLength = (unsigned int)cJSON_GetObjectItem(pConfigurationData, "CisternLength")->valueint;
-	unsigned int distanceEmpty = (unsigned int)cJSON_GetObjectItem(pConfigurationData, "DistanceEmpty")->valueint;
-	unsigned int litersFull = (unsigned int)cJSON_GetObjectItem(pConfigurationData, "LitersFull")->valueint;
+	// the first cistern is described by the top level values; the others by the "AdditionalCisterns" array
+	CisternParameters cisterns[ULTRASONIC_CHANNEL_COUNT];
+	bool areCisternsValid = configuration_parseCistern(pConfigurationData, &cisterns[0]);
+	cJSON *additionalCisterns = cJSON_GetObjectItem(pConfigurationData, "AdditionalCisterns");
+	for (int i = 1; i < ULTRASONIC_CHANNEL_COUNT; i++)
+	{
+		if (additionalCisterns == NULL || cJSON_GetArraySize(additionalCisterns) < i)
+		{
+			areCisternsValid = FALSE;
+			break;
+		}
+		areCisternsValid = configuration_parseCistern(cJSON_GetArrayItem(additionalCisterns, i - 1), &cisterns[i]) && areCisternsValid;
+	}
 	char *hostname = cJSON_GetObjectItem(pConfigurationData, "HostName")->valuestring;
 	int deepSleepPeriod = cJSON_GetObjectItem(pConfigurationData, "DeepSleepPeriod")->valueint;
 	int minDifferenceToPost = cJSON_GetObjectItem(pConfigurationData, "MinDifferenceToPost")->valueint;
 	int maxDataAgeToPost = cJSON_GetObjectItem(pConfigurationData, "MaxDataAgeToPost")->valueint;
+	// optional; older configuration tools don't know the continuous mode
+	cJSON *continuousPeriodItem = cJSON_GetObjectItem(pConfigurationData, "ContinuousPeriod");
+	int continuousPeriod = continuousPeriodItem != NULL ? continuousPeriodItem->valueint : 0;
 	unsigned char shouldPostToThingspeak = (unsigned char)cJSON_GetObjectItem(pConfigurationData, "ShouldPostToThingspeak")->valueint;
 	char *thingspeakServerUrl = cJSON_GetObjectItem(pConfigurationData, "ThingspeakServerUrl")->valuestring;
 	char *thingspeakApiKey = cJSON_GetObjectItem(pConfigurationData, "ThingspeakApiKey")->valuestring;
@@ -106,12 +269,19 @@ static bool ICACHE_FLASH_ATTR configuration_parseData(cJSON *pConfigurationData)
 	char *logHost = cJSON_GetObjectItem(pConfigurationData, "LogHost")->valuestring;
 	unsigned short logPort = (unsigned short)cJSON_GetObjectItem(pConfigurationData, "LogPort")->valueint;
 
+#ifdef BATCH_POSTING
+	// the batch is published via MQTT only; it's kept until it's published
+	bool isBatchPostingValid = shouldPostToMqtt == 1;
+#else
+	bool isBatchPostingValid = TRUE;
+#endif
+
 	// all data found in the received json data?
-	if (strlen(ssid) > 0 && strlen(password) > 0 &&
-		((cisternType == 1 && cisternLength > 0) || cisternType == 2) &&
-		cisternRadius > 0 && distanceEmpty > 0 && litersFull > 0 &&
+	if (strlen(ssid) > 0 && strlen(password) > 0 && areCisternsValid && isBatchPostingValid &&
 		strlen(hostname) > 0 && deepSleepPeriod > 0 &&
 		minDifferenceToPost > 0 && maxDataAgeToPost > 0 &&
+		// the continuous mode publishes via MQTT only
+		(continuousPeriod == 0 || (continuousPeriod >= CONTINUOUS_MIN_PERIOD_MS && continuousPeriod <= 0xFFFF && shouldPostToMqtt == 1)) &&
 		((shouldPostToThingspeak == 1 && strlen(thingspeakServerUrl) > 0 && strlen(thingspeakApiKey) > 0) ||
 		(shouldPostToMqtt == 1 && strlen(mqttServer) > 0 && mqttPort != 0 && strlen(mqttClientName) > 0 && strlen(mqttTopic) > 0)))
 	{
@@ -122,15 +292,12 @@ static bool ICACHE_FLASH_ATTR configuration_parseData(cJSON *pConfigurationData)
 		configuration_data.version = CONFIGURATION_DATA_VERSION;
 		os_strcpy(configuration_data.wifiSsid, ssid);
 		os_strcpy(configuration_data.wifiPassword, password);
-		configuration_data.cisternType = cisternType;
-		configuration_data.cisternRadius = cisternRadius;
-		configuration_data.cisternLength = cisternLength;
-		configuration_data.distanceEmpty = distanceEmpty;
-		configuration_data.litersFull = litersFull;
+		os_memcpy(configuration_data.cisterns, cisterns, sizeof(configuration_data.cisterns));
 		os_strcpy(configuration_data.hostname, hostname);
 		configuration_data.deepSleepPeriod = deepSleepPeriod;
 		configuration_data.minDifferenceToPost = minDifferenceToPost;
 		configuration_data.maxDataAgeToPost = maxDataAgeToPost;
+		configuration_data.continuousPeriod = continuousPeriod;
 		configuration_data.shouldPostToThingspeak = shouldPostToThingspeak;
 		os_strcpy(configuration_data.thingspeakServerUrl, thingspeakServerUrl);
 		os_strcpy(configuration_data.thingspeakApiKey, thingspeakApiKey);
@@ -153,6 +320,48 @@ static bool ICACHE_FLASH_ATTR configuration_parseData(cJSON *pConfigurationData)
 	}
 }
 
+#ifdef ULTRASONIC_TRACE
+// adds the trace of the last measurement cycle as hex string to the response
+static void ICACHE_FLASH_ATTR configuration_addTrace(cJSON *pResponse, cJSON *pData)
+{
+	Trace *trace = (Trace*)os_malloc(sizeof(Trace));
+	unsigned short size = trace_load(trace);
+	if (size > 0)
+	{
+		// two hex digits per byte
+		char *hex = (char*)os_malloc(size * 2 + 1);
+		for (unsigned short i = 0; i < size; i++)
+		{
+			os_sprintf(hex + i * 2, "%02x", ((uint8*)trace)[i]);
+		}
+		hex[size * 2] = 0;
+		cJSON_AddNumberToObject(pResponse, "ResponseCode", 5);
+		cJSON_AddStringToObject(pData, "Trace", hex);
+		os_free(hex);
+	}
+	else
+	{
+		cJSON_AddNumberToObject(pResponse, "ResponseCode", -1);
+	}
+	os_free(trace);
+}
+#endif
+
+// checks that every cistern of type 3 has a strapping table; the received one if there is one, otherwise the saved one
+// a type 3 cistern without a table would always report an empty cistern
+static unsigned char ICACHE_FLASH_ATTR configuration_areStrappingTablesValid()
+{
+	for (int i = 0; i < ULTRASONIC_CHANNEL_COUNT; i++)
+	{
+		if (configuration_data.cisterns[i].cisternType == 3 && strappingtable_getPointCount(i) < 2)
+		{
+			os_printf("Configuration not saved: no strapping table for the cistern of channel %d\n", i);
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
 // will be called after data was received via the tcp server connection
 static void ICACHE_FLASH_ATTR configuration_receiveCallback(void *arg, char *pdata, unsigned short len)
 {
@@ -163,8 +372,17 @@ static void ICACHE_FLASH_ATTR configuration_receiveCallback(void *arg, char *pda
 	cJSON_AddItemToObject(response, "ResponseData", data);
 	char *rendered;
 	unsigned char writeResponse = FALSE;
+	unsigned char commandCode = cJSON_GetObjectItem(root, "CommandCode")->valueint;
+
+	// every command stops the streaming
+	if (configuration_isStreaming == TRUE && commandCode != 6)
+	{
+		configuration_isStreaming = FALSE;
+		os_timer_disarm(&configuration_streamTimer);
+		io_ledBlink(500, 500);
+	}
 
-	switch (cJSON_GetObjectItem(root, "CommandCode")->valueint)
+	switch (commandCode)
 	{
 		// DoMeasurement
 	case 1:
@@ -178,15 +396,22 @@ static void ICACHE_FLASH_ATTR configuration_receiveCallback(void *arg, char *pda
 			cJSON_AddNumberToObject(response, "ResponseCode", 2);
 			cJSON_AddStringToObject(data, "SSID", configuration_data.wifiSsid);
 			cJSON_AddStringToObject(data, "Password", configuration_data.wifiPassword);
-			cJSON_AddNumberToObject(data, "CisternType", configuration_data.cisternType);
-			cJSON_AddNumberToObject(data, "CisternRadius", configuration_data.cisternRadius);
-			cJSON_AddNumberToObject(data, "CisternLength", configuration_data.cisternLength);
-			cJSON_AddNumberToObject(data, "DistanceEmpty", configuration_data.distanceEmpty);
-			cJSON_AddNumberToObject(data, "LitersFull", configuration_data.litersFull);
+			configuration_addCistern(data, &configuration_data.cisterns[0]);
+#if ULTRASONIC_CHANNEL_COUNT > 1
+			cJSON *additionalCisterns = cJSON_CreateArray();
+			cJSON_AddItemToObject(data, "AdditionalCisterns", additionalCisterns);
+			for (int i = 1; i < ULTRASONIC_CHANNEL_COUNT; i++)
+			{
+				cJSON *cistern = cJSON_CreateObject();
+				configuration_addCistern(cistern, &configuration_data.cisterns[i]);
+				cJSON_AddItemToArray(additionalCisterns, cistern);
+			}
+#endif
 			cJSON_AddStringToObject(data, "HostName", configuration_data.hostname);
 			cJSON_AddNumberToObject(data, "DeepSleepPeriod", configuration_data.deepSleepPeriod);
 			cJSON_AddNumberToObject(data, "MinDifferenceToPost", configuration_data.minDifferenceToPost);
 			cJSON_AddNumberToObject(data, "MaxDataAgeToPost", configuration_data.maxDataAgeToPost);
+			cJSON_AddNumberToObject(data, "ContinuousPeriod", configuration_data.continuousPeriod);
 			cJSON_AddNumberToObject(data, "ShouldPostToThingspeak", configuration_data.shouldPostToThingspeak);
 			cJSON_AddStringToObject(data, "ThingspeakServerUrl", configuration_data.thingspeakServerUrl);
 			cJSON_AddStringToObject(data, "ThingspeakApiKey", configuration_data.thingspeakApiKey);
@@ -220,14 +445,62 @@ static void ICACHE_FLASH_ATTR configuration_receiveCallback(void *arg, char *pda
 		wifi_station_disconnect();
 		wifi_set_opmode_current(NULL_MODE);
 		// if configuration is valid => save in flash
-		if (configuration_data.version == CONFIGURATION_DATA_VERSION)
+		if (configuration_data.version == CONFIGURATION_DATA_VERSION && configuration_areStrappingTablesValid() == TRUE)
 		{
 			// use the protected write to three sectors method
 			system_param_save_with_protect(CONFIGURATION_DATA_START_SEC, &configuration_data, sizeof(configuration_data));
 		}
+		// the strapping tables are written with their own command; only erase the sector if a new table was uploaded
+		if (strappingtable_isReceived() == TRUE)
+		{
+			strappingtable_save();
+		}
 		// leave configuration mode and reboot
 		powermanagement_leaveConfigurationMode();
 		break;
+
+#ifdef ULTRASONIC_TRACE
+		// ReadTrace
+	case 5:
+		configuration_addTrace(response, data);
+		writeResponse = TRUE;
+		break;
+#endif
+
+		// StreamMeasurements
+	case 6:
+		if (configuration_isStreaming == FALSE)
+		{
+			configuration_isStreaming = TRUE;
+			configuration_streamIndex = 0;
+			for (int i = 0; i < ULTRASONIC_CHANNEL_COUNT; i++)
+			{
+				for (int j = 0; j < STREAM_WINDOW_SIZE; j++)
+				{
+					configuration_streamDistances[i][j] = -1;
+				}
+			}
+			ultrasonicMeter_startMeasurement(configuration_sendStreamedMeasurement, TRUE);
+		}
+		break;
+
+		// StopStreaming; the streaming is already stopped above
+	case 7:
+		cJSON_AddNumberToObject(response, "ResponseCode", 7);
+		writeResponse = TRUE;
+		break;
+
+		// WriteStrappingTable; the table is saved into flash with SaveConfigurationAndReboot
+	case 8:
+		cJSON_AddNumberToObject(response, "ResponseCode", configuration_parseStrappingTable(cJSON_GetObjectItem(root, "CommandData")) == TRUE ? 8 : -1);
+		writeResponse = TRUE;
+		break;
+
+		// ReadStrappingTable
+	case 9:
+		configuration_addStrappingTable(cJSON_GetObjectItem(root, "CommandData"), response, data);
+		writeResponse = TRUE;
+		break;
 	}
 
 	// should we send a response back now?
@@ -244,9 +517,26 @@ static void ICACHE_FLASH_ATTR configuration_receiveCallback(void *arg, char *pda
 	cJSON_Delete(response);
 }
 
+// timer function; starts the next streamed measurement
+static void ICACHE_FLASH_ATTR configuration_streamTimerTick(void *arg)
+{
+	if (configuration_isStreaming == TRUE)
+	{
+		ultrasonicMeter_startMeasurement(configuration_sendStreamedMeasurement, TRUE);
+	}
+}
+
 // will be called after data was sent via the tcp server connection
 static void ICACHE_FLASH_ATTR configuration_sentCallback(void *arg)
 {
+	// keep the connection open while streaming; the next measurement is started after the data was sent
+	if (configuration_isStreaming == TRUE)
+	{
+		os_timer_disarm(&configuration_streamTimer);
+		os_timer_setfn(&configuration_streamTimer, configuration_streamTimerTick, NULL);
+		os_timer_arm(&configuration_streamTimer, STREAM_PERIOD_MS, 0);
+		return;
+	}
 	// close the tcp connection immediately 
 	espconn_disconnect((espconn*)arg);
 }
@@ -266,6 +556,13 @@ static void ICACHE_FLASH_ATTR configuration_disconnectCallback(void *arg)
 	os_printf("Disconnected from %d.%d.%d.%d:%d\n", conn->proto.tcp->remote_ip[0],
 		conn->proto.tcp->remote_ip[1], conn->proto.tcp->remote_ip[2],
 		conn->proto.tcp->remote_ip[3], conn->proto.tcp->remote_port);
+	// a closed connection cancels the streaming
+	if (configuration_isStreaming == TRUE)
+	{
+		configuration_isStreaming = FALSE;
+		os_timer_disarm(&configuration_streamTimer);
+		io_ledBlink(500, 500);
+	}
 }
 
 // will be called after a TCp client has connected to the TCP server
@@ -287,7 +584,7 @@ void ICACHE_FLASH_ATTR configuration_sendSingleShotMeasurement()
 	io_ledBlink(500, 500);
 
 	// read and send distance
-	int distance = (int)ultrasonicMeter_getSingleShotDistance();
+	int distance = (int)(ultrasonicMeter_getSingleShotDistance(0) / DISTANCE_UNITS_PER_MM);
 	cJSON *response = cJSON_CreateObject();
 	cJSON *data = cJSON_CreateObject();
 	cJSON_AddItemToObject(response, "ResponseData", data);
@@ -302,6 +599,16 @@ void ICACHE_FLASH_ATTR configuration_sendSingleShotMeasurement()
 		cJSON_AddFalseToObject(data, "IsValid");
 		cJSON_AddNumberToObject(data, "Distance", -1);
 	}
+#if ULTRASONIC_CHANNEL_COUNT > 1
+	// the distances of the additional cisterns; -1 if invalid
+	cJSON *additionalDistances = cJSON_CreateArray();
+	cJSON_AddItemToObject(data, "AdditionalDistances", additionalDistances);
+	for (int i = 1; i < ULTRASONIC_CHANNEL_COUNT; i++)
+	{
+		distance = (int)(ultrasonicMeter_getSingleShotDistance(i) / DISTANCE_UNITS_PER_MM);
+		cJSON_AddItemToArray(additionalDistances, cJSON_CreateNumber(distance > 0 ? distance : -1));
+	}
+#endif
 	char *rendered = cJSON_Print(response);
 	os_printf("JSON: %s\n", rendered);
 	espconn_send(&configuration_socketConnection, (uint8_t *)rendered, os_strlen(rendered));
@@ -310,6 +617,62 @@ void ICACHE_FLASH_ATTR configuration_sendSingleShotMeasurement()
 	os_free(rendered);
 }
 
+// adds the single shot distance and the filtered distance of the channel in millimeters to the streamed data; -1 if invalid
+static void ICACHE_FLASH_ATTR configuration_addStreamedDistances(unsigned char pChannel, cJSON *pDistances, cJSON *pFilteredDistances)
+{
+	sint32 distance = ultrasonicMeter_getSingleShotDistance(pChannel);
+	sint32 filteredDistance;
+	sint32 dispersion;
+
+	configuration_streamDistances[pChannel][configuration_streamIndex] = distance > 0 ? distance : -1;
+	if (estimator_estimate(ULTRASONIC_ESTIMATOR, configuration_streamDistances[pChannel], STREAM_WINDOW_SIZE, &filteredDistance, &dispersion) == 0)
+	{
+		filteredDistance = -DISTANCE_UNITS_PER_MM;
+	}
+	cJSON_AddItemToArray(pDistances, cJSON_CreateNumber(distance > 0 ? (int)(distance / DISTANCE_UNITS_PER_MM) : -1));
+	cJSON_AddItemToArray(pFilteredDistances, cJSON_CreateNumber((int)(filteredDistance / DISTANCE_UNITS_PER_MM)));
+}
+
+// called after a streamed single shot measurement is finished; sends the single shot and the filtered distances of all channels
+static void ICACHE_FLASH_ATTR configuration_sendStreamedMeasurement()
+{
+	// canceled while measuring?
+	if (configuration_isStreaming == FALSE)
+	{
+		io_ledBlink(500, 500);
+		return;
+	}
+
+	cJSON *response = cJSON_CreateObject();
+	cJSON *data = cJSON_CreateObject();
+	cJSON_AddItemToObject(response, "ResponseData", data);
+	cJSON_AddNumberToObject(response, "ResponseCode", 6);
+	// one value per channel
+	cJSON *distances = cJSON_CreateArray();
+	cJSON_AddItemToObject(data, "Distances", distances);
+	cJSON *filteredDistances = cJSON_CreateArray();
+	cJSON_AddItemToObject(data, "FilteredDistances", filteredDistances);
+	for (int i = 0; i < ULTRASONIC_CHANNEL_COUNT; i++)
+	{
+		configuration_addStreamedDistances(i, distances, filteredDistances);
+	}
+	configuration_streamIndex = (configuration_streamIndex + 1) % STREAM_WINDOW_SIZE;
+
+	// one line per measurement
+	char *rendered = cJSON_PrintUnformatted(response);
+	os_printf("JSON: %s\n", rendered);
+	// the next measurement is started after the data was sent; see configuration_sentCallback
+	if (espconn_send(&configuration_socketConnection, (uint8_t *)rendered, os_strlen(rendered)) != 0)
+	{
+		// the connection is gone
+		configuration_isStreaming = FALSE;
+		io_ledBlink(500, 500);
+	}
+	// free memory
+	os_free(rendered);
+	cJSON_Delete(response);
+}
+
 // start the configuration mode
 void ICACHE_FLASH_ATTR configuration_start()
 {
@@ -408,6 +771,12 @@ unsigned short ICACHE_FLASH_ATTR configuration_getMaxDataAgeToPost()
 	return configuration_data.maxDataAgeToPost;
 }
 
+// measurement period in milliseconds of the continuous mode for mains-powered installations; 0 = deep sleep mode
+unsigned short ICACHE_FLASH_ATTR configuration_getContinuousPeriod()
+{
+	return configuration_data.continuousPeriod;
+}
+
 // if TRUE the data should be posted to a Thingspeak server
 unsigned char ICACHE_FLASH_ATTR configuration_shouldPostToThingspeak()
 {
@@ -460,21 +829,33 @@ char* ICACHE_FLASH_ATTR configuration_getMqttTopic()
 	return configuration_data.mqttTopic;
 }
 
-// returns the cistern parameters in the parameters
-void ICACHE_FLASH_ATTR configuration_getCisternParameters(unsigned char *cisternType, unsigned int *cisternRadius,
+// returns the parameters of the cistern of the ultrasonic sensor channel in the parameters
+void ICACHE_FLASH_ATTR configuration_getCisternParameters(unsigned char channel, unsigned char *cisternType, unsigned int *cisternRadius,
 	unsigned int *cisternLength, unsigned int *distanceEmpty, unsigned int *litersFull)
 {
-	*cisternType = configuration_data.cisternType;
-	*cisternRadius = configuration_data.cisternRadius;
-	*cisternLength = configuration_data.cisternLength;
-	*distanceEmpty = configuration_data.distanceEmpty;
-	*litersFull = configuration_data.litersFull;
+	CisternParameters *cistern = &configuration_data.cisterns[channel];
+	*cisternType = cistern->cisternType;
+	*cisternRadius = cistern->cisternRadius;
+	*cisternLength = cistern->cisternLength;
+	*distanceEmpty = cistern->distanceEmpty;
+	*litersFull = cistern->litersFull;
+}
+
+// returns the additional dimensions of the cistern of the ultrasonic sensor channel in the parameters; see CisternParameters
+void ICACHE_FLASH_ATTR configuration_getCisternShape(unsigned char channel, unsigned int *cisternWidth, unsigned int *cisternHeight,
+	unsigned int *cisternTopRadius, unsigned int *cisternDomeDepth)
+{
+	CisternParameters *cistern = &configuration_data.cisterns[channel];
+	*cisternWidth = cistern->cisternWidth;
+	*cisternHeight = cistern->cisternHeight;
+	*cisternTopRadius = cistern->cisternTopRadius;
+	*cisternDomeDepth = cistern->cisternDomeDepth;
 }
 
-// gets the distance in millimeters water to ultrasonic sensor if the cistern is empty
-unsigned int ICACHE_FLASH_ATTR configuration_getDistanceEmpty()
+// gets the distance in millimeters water to ultrasonic sensor of the channel if the cistern is empty
+unsigned int ICACHE_FLASH_ATTR configuration_getDistanceEmpty(unsigned char channel)
 {
-	return configuration_data.distanceEmpty;
+	return configuration_data.cisterns[channel].distanceEmpty;
 }
 
 // return the log type: 0 = logging disabled; 1 = logging will be sent using insecure TCP connection; 2 = logging will be sent using secure TCP connection
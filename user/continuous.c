@@ -0,0 +1,157 @@
+/*
+* ----------------------------------------------------------------------------
+* The MIT License (MIT)
+*
+* Copyright (c) 2016 - Matthias Jentsch
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+* ----------------------------------------------------------------------------
+*/
+
+#include "user_interface.h"
+#include "osapi.h"
+#include <espmissingincludes.h>
+#include <ultrasonicmeter.h>
+#include <estimator.h>
+#include <configuration.h>
+#include <posting.h>
+#include <continuous.h>
+
+// count of shots per channel and measurement period; the window filter does the rest
+#define CONTINUOUS_SHOTS 1
+// the water level is estimated from the distances of this count of the last measurement periods (see ULTRASONIC_ESTIMATOR);
+// that's a delay of about half the window for a fill or drain event
+#define CONTINUOUS_WINDOW_SIZE 5
+// const for a water level that isn't published yet
+#define WATER_LEVEL_INVALID (-10000 * DISTANCE_UNITS_PER_MM)
+
+// the timer for the measurement periods
+static ETSTimer continuous_periodTimer;
+// TRUE while a measurement is running
+static unsigned char continuous_isMeasuring = FALSE;
+// TRUE after the first connection to the MQTT broker was started
+static unsigned char continuous_isMqttStarted = FALSE;
+// the distances of the last measurement periods per channel in 1/DISTANCE_UNITS_PER_MM mm; -1 if invalid
+static sint32 continuous_distances[ULTRASONIC_CHANNEL_COUNT][CONTINUOUS_WINDOW_SIZE];
+// the index in continuous_distances for the next measurement period
+static unsigned char continuous_windowIndex = 0;
+// the last published water levels per channel in 1/DISTANCE_UNITS_PER_MM mm
+static sint32 continuous_publishedWaterLevels[ULTRASONIC_CHANNEL_COUNT];
+// milliseconds since the water levels were published the last time
+static uint32 continuous_msSincePublish = 0;
+
+// called after the measurement of one period is finished; filters the water levels and publishes them if needed
+static void ICACHE_FLASH_ATTR continuous_measurementFinished()
+{
+	sint32 waterLevels[ULTRASONIC_CHANNEL_COUNT];
+	// unchanged water levels are published after the same time as in the deep sleep mode
+	unsigned char shouldPublish = continuous_msSincePublish / 1000 >= (uint32)configuration_getMaxDataAgeToPost() * configuration_getDeepSleepPeriod();
+	unsigned char areWaterLevelsValid = TRUE;
+
+	continuous_isMeasuring = FALSE;
+	for (int i = 0; i < ULTRASONIC_CHANNEL_COUNT; i++)
+	{
+		sint32 distanceEmpty = (sint32)configuration_getDistanceEmpty(i) * DISTANCE_UNITS_PER_MM;
+		sint32 distance;
+		sint32 dispersion;
+
+		// the estimators work with the distances; the water level is 0 if there was no valid shot
+		continuous_distances[i][continuous_windowIndex] = ultrasonicMeter_getValidShotCount(i) > 0 ? distanceEmpty - ultrasonicMeter_getWaterLevel(i) : -1;
+		if (estimator_estimate(ULTRASONIC_ESTIMATOR, continuous_distances[i], CONTINUOUS_WINDOW_SIZE, &distance, &dispersion) > 0)
+		{
+			waterLevels[i] = distanceEmpty - distance;
+		}
+		else
+		{
+			// no valid distance in the window; keep the last published water level
+			waterLevels[i] = continuous_publishedWaterLevels[i];
+		}
+		if (waterLevels[i] == WATER_LEVEL_INVALID)
+		{
+			areWaterLevelsValid = FALSE;
+			continue;
+		}
+		sint32 difference = waterLevels[i] - continuous_publishedWaterLevels[i];
+		if (difference < 0)
+		{
+			difference = -difference;
+		}
+		if (continuous_publishedWaterLevels[i] == WATER_LEVEL_INVALID || difference >= (sint32)configuration_getMinDifferenceToPost() * DISTANCE_UNITS_PER_MM)
+		{
+			shouldPublish = TRUE;
+		}
+	}
+	continuous_windowIndex = (continuous_windowIndex + 1) % CONTINUOUS_WINDOW_SIZE;
+
+	if (shouldPublish == TRUE && areWaterLevelsValid == TRUE && posting_publishContinuous(waterLevels) == TRUE)
+	{
+		os_memcpy(continuous_publishedWaterLevels, waterLevels, sizeof(continuous_publishedWaterLevels));
+		continuous_msSincePublish = 0;
+	}
+}
+
+// timer function; starts the measurement of the next period
+static void ICACHE_FLASH_ATTR continuous_periodTimerTick(void *arg)
+{
+	continuous_msSincePublish += configuration_getContinuousPeriod();
+	// the measurement of the last period is still running? then skip this period
+	if (continuous_isMeasuring == TRUE)
+	{
+		return;
+	}
+	continuous_isMeasuring = TRUE;
+	ultrasonicMeter_setMaxShots(CONTINUOUS_SHOTS);
+	ultrasonicMeter_startMeasurement(continuous_measurementFinished, FALSE);
+}
+
+// called on Wifi events; connects to the MQTT broker after the connection to the access point is established
+static void ICACHE_FLASH_ATTR continuous_wifiEvent(System_Event_t *evt)
+{
+	os_printf("event %x\n", evt->event);
+	// the MQTT client reconnects by itself after the first connection
+	if (evt->event == EVENT_STAMODE_GOT_IP && continuous_isMqttStarted == FALSE)
+	{
+		wifi_station_set_hostname(configuration_getHostname());
+		os_printf("Connecting to MQTT broker...\n");
+		posting_connectMqtt();
+		continuous_isMqttStarted = TRUE;
+	}
+}
+
+// starts the continuous mode for mains-powered installations; the module doesn't sleep, measures every ContinuousPeriod milliseconds
+// and publishes the water levels over an open MQTT connection if they have changed or are too old
+void ICACHE_FLASH_ATTR continuous_start()
+{
+	os_printf("\nStarting continuous mode with %d ms period ...\n", configuration_getContinuousPeriod());
+	for (int i = 0; i < ULTRASONIC_CHANNEL_COUNT; i++)
+	{
+		continuous_publishedWaterLevels[i] = WATER_LEVEL_INVALID;
+		for (int j = 0; j < CONTINUOUS_WINDOW_SIZE; j++)
+		{
+			continuous_distances[i][j] = -1;
+		}
+	}
+
+	posting_initializeContinuousMqtt();
+	posting_connectWifi(continuous_wifiEvent);
+
+	os_timer_disarm(&continuous_periodTimer);
+	os_timer_setfn(&continuous_periodTimer, continuous_periodTimerTick, NULL);
+	os_timer_arm(&continuous_periodTimer, configuration_getContinuousPeriod(), 1);
+}
\ No newline at end of file
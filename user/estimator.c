@@ -0,0 +1,205 @@
+/*
+* ----------------------------------------------------------------------------
+* The MIT License (MIT)
+*
+* Copyright (c) 2016 - Matthias Jentsch
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+* ----------------------------------------------------------------------------
+*/
+
+#include "c_types.h"
+#include <ultrasonicmeter.h>
+#include <estimator.h>
+
+// the Hampel filter accepts values within HAMPEL_K * 1.4826 * MAD around the median; 1.4826 scales the MAD to a standard deviation
+#define HAMPEL_SCALED_K_PER_MILLE 4448
+// but the accepted window is never smaller than +/- 1 mm; otherwise an echo jitter of one unit would be an outlier if MAD is 0
+#define HAMPEL_MIN_WINDOW (1 * DISTANCE_UNITS_PER_MM)
+
+// swaps two values
+static void ICACHE_FLASH_ATTR estimator_swap(sint32 *pValues, unsigned char a, unsigned char b)
+{
+	sint32 value = pValues[a];
+	pValues[a] = pValues[b];
+	pValues[b] = value;
+}
+
+// selects the k-th smallest value (k starts with 0) in O(n); the order of the values will be changed
+static sint32 ICACHE_FLASH_ATTR estimator_select(sint32 *pValues, unsigned char count, unsigned char k)
+{
+	unsigned char left = 0;
+	unsigned char right = count - 1;
+	while (left < right)
+	{
+		// partition around the middle value (Lomuto)
+		unsigned char pivotIndex = left + (right - left) / 2;
+		sint32 pivot = pValues[pivotIndex];
+		estimator_swap(pValues, pivotIndex, right);
+		unsigned char storeIndex = left;
+		for (unsigned char i = left; i < right; i++)
+		{
+			if (pValues[i] < pivot)
+			{
+				estimator_swap(pValues, i, storeIndex);
+				storeIndex++;
+			}
+		}
+		estimator_swap(pValues, storeIndex, right);
+
+		if (k == storeIndex)
+		{
+			break;
+		}
+		else if (k < storeIndex)
+		{
+			right = storeIndex - 1;
+		}
+		else
+		{
+			left = storeIndex + 1;
+		}
+	}
+	return pValues[k];
+}
+
+// gets the median of the values; the order of the values will be changed
+static sint32 ICACHE_FLASH_ATTR estimator_median(sint32 *pValues, unsigned char count)
+{
+	sint32 upper = estimator_select(pValues, count, count / 2);
+	if ((count & 1) == 1)
+	{
+		return upper;
+	}
+	// even count: the mean of the two middle values; after the selection the lower one is the max of the lower half
+	sint32 lower = pValues[0];
+	for (unsigned char i = 1; i < count / 2; i++)
+	{
+		if (pValues[i] > lower)
+		{
+			lower = pValues[i];
+		}
+	}
+	return (lower + upper) / 2;
+}
+
+// sorts the values (insertion sort; we have only a few values)
+static void ICACHE_FLASH_ATTR estimator_sort(sint32 *pValues, unsigned char count)
+{
+	for (unsigned char i = 1; i < count; i++)
+	{
+		sint32 value = pValues[i];
+		unsigned char j = i;
+		while (j > 0 && pValues[j - 1] > value)
+		{
+			pValues[j] = pValues[j - 1];
+			j--;
+		}
+		pValues[j] = value;
+	}
+}
+
+// gets the rounded mean of the values from index first to index last - 1
+static sint32 ICACHE_FLASH_ATTR estimator_mean(const sint32 *pValues, unsigned char first, unsigned char last)
+{
+	sint32 sum = 0;
+	for (unsigned char i = first; i < last; i++)
+	{
+		sum += pValues[i];
+	}
+	sint32 count = last - first;
+	return (sum + count / 2) / count;
+}
+
+// estimates the central value of the given values; values <= 0 are invalid and will be ignored
+// pEstimate receives the estimated value and pDispersion the median absolute deviation of the valid values
+// returns the count of valid values; if zero then pEstimate and pDispersion are set to 0
+unsigned char ICACHE_FLASH_ATTR estimator_estimate(unsigned char estimatorType, const sint32 *pValues, unsigned char count,
+	sint32 *pEstimate, sint32 *pDispersion)
+{
+	sint32 values[ESTIMATOR_MAX_VALUES];
+	sint32 deviations[ESTIMATOR_MAX_VALUES];
+	unsigned char validCount = 0;
+
+	// copy the valid values
+	for (unsigned char i = 0; i < count && validCount < ESTIMATOR_MAX_VALUES; i++)
+	{
+		if (pValues[i] > 0)
+		{
+			values[validCount] = pValues[i];
+			validCount++;
+		}
+	}
+	*pEstimate = 0;
+	*pDispersion = 0;
+	if (validCount == 0)
+	{
+		return 0;
+	}
+
+	// the median and the median absolute deviation are needed for the dispersion and the Hampel filter
+	sint32 median = estimator_median(values, validCount);
+	for (unsigned char i = 0; i < validCount; i++)
+	{
+		deviations[i] = (values[i] > median) ? values[i] - median : median - values[i];
+	}
+	*pDispersion = estimator_median(deviations, validCount);
+
+	switch (estimatorType)
+	{
+	case ESTIMATOR_MEDIAN:
+		*pEstimate = median;
+		break;
+
+	case ESTIMATOR_HAMPEL_MEAN:
+	{
+		// the window around the median; values outside are outliers
+		sint32 window = *pDispersion * HAMPEL_SCALED_K_PER_MILLE / 1000;
+		if (window < HAMPEL_MIN_WINDOW)
+		{
+			window = HAMPEL_MIN_WINDOW;
+		}
+		unsigned char inlierCount = 0;
+		for (unsigned char i = 0; i < validCount; i++)
+		{
+			if (values[i] >= median - window && values[i] <= median + window)
+			{
+				values[inlierCount] = values[i];
+				inlierCount++;
+			}
+		}
+		// the median itself is always an inlier
+		*pEstimate = estimator_mean(values, 0, inlierCount);
+		break;
+	}
+
+	case ESTIMATOR_INTERQUARTILE_MEAN:
+		estimator_sort(values, validCount);
+		// with less than 4 values there are no quartiles to cut
+		*pEstimate = estimator_mean(values, validCount / 4, validCount - validCount / 4);
+		break;
+
+	default:
+		estimator_sort(values, validCount);
+		// do we have at least 3 values? then cut the min an max value
+		*pEstimate = (validCount >= 3) ? estimator_mean(values, 1, validCount - 1) : estimator_mean(values, 0, validCount);
+		break;
+	}
+	return validCount;
+}
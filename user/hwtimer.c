@@ -0,0 +1,84 @@
+/*
+* ----------------------------------------------------------------------------
+* The MIT License (MIT)
+*
+* Copyright (c) 2016 - Matthias Jentsch
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+* ----------------------------------------------------------------------------
+*/
+
+#include "user_interface.h"
+#include "osapi.h"
+#include <espmissingincludes.h>
+#include <hwtimer.h>
+
+// FRC1 control register bits; the timer counts down from the load value and raises an edge interrupt at zero
+// prescaler 16
+#define FRC1_DIVIDED_BY_16 4
+// edge interrupt
+#define FRC1_EDGE_INT 0
+// timer enabled
+#define FRC1_ENABLE BIT7
+
+// the callback that is called if the timer is elapsed
+static hwtimer_callback *hwtimer_callbackFunction = NULL;
+
+// interrupt handler of the FRC1 timer; placed in IRAM
+static void hwtimer_interrupt(void *arg)
+{
+	// without auto reload the counter would wrap around and fire again; so stop it
+	RTC_REG_WRITE(FRC1_CTRL_ADDRESS, FRC1_DIVIDED_BY_16 | FRC1_EDGE_INT);
+	if (hwtimer_callbackFunction != NULL)
+	{
+		hwtimer_callbackFunction();
+	}
+}
+
+// initializes the FRC1 hardware timer; the callback is called after the timespan given to hwtimer_arm is elapsed
+void ICACHE_FLASH_ATTR hwtimer_init(hwtimer_callback *pCallback)
+{
+	hwtimer_callbackFunction = pCallback;
+	// timer stopped until hwtimer_arm is called
+	RTC_REG_WRITE(FRC1_CTRL_ADDRESS, FRC1_DIVIDED_BY_16 | FRC1_EDGE_INT);
+	ETS_FRC_TIMER1_INTR_ATTACH(hwtimer_interrupt, NULL);
+	TM1_EDGE_INT_ENABLE();
+	ETS_FRC1_INTR_ENABLE();
+}
+
+// starts the hardware timer; the callback is called once after the given microseconds (HWTIMER_MIN_US to HWTIMER_MAX_US); may be called in interrupt context
+void hwtimer_arm(uint32 us)
+{
+	if (us < HWTIMER_MIN_US)
+	{
+		us = HWTIMER_MIN_US;
+	}
+	else if (us > HWTIMER_MAX_US)
+	{
+		us = HWTIMER_MAX_US;
+	}
+	RTC_REG_WRITE(FRC1_LOAD_ADDRESS, us * HWTIMER_TICKS_PER_US);
+	RTC_REG_WRITE(FRC1_CTRL_ADDRESS, FRC1_DIVIDED_BY_16 | FRC1_EDGE_INT | FRC1_ENABLE);
+}
+
+// stops the hardware timer; may be called in interrupt context
+void hwtimer_disarm()
+{
+	RTC_REG_WRITE(FRC1_CTRL_ADDRESS, FRC1_DIVIDED_BY_16 | FRC1_EDGE_INT);
+}
\ No newline at end of file
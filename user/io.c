@@ -30,6 +30,7 @@
 #include "gpio.h"
 #include "smartconfig.h"
 #include <espmissingincludes.h>
+#include <ultrasonicmeter.h>
 #include <powermanagement.h>
 #include <io.h>
 
@@ -101,6 +102,16 @@ void ICACHE_FLASH_ATTR io_init()
 	gpio_output_set(0, 0, (1 << TRIGGER_GPIO) | (1 << LED_GPIO), (1 << CONFIG_BUTTON_GPIO) | (1 << ECHO_GPIO));
 	// don't trigger the ultrasonic sensor and switch the wifi led off
 	gpio_output_set(0, (1 << TRIGGER_GPIO) | (1 << LED_GPIO), (1 << TRIGGER_GPIO) | (1 << LED_GPIO), 0);
+#if ULTRASONIC_CHANNEL_COUNT > 1
+	// the pins of the second ultrasonic sensor
+	PIN_FUNC_SELECT(PERIPHS_IO_MUX_GPIO4_U, FUNC_GPIO4);
+	PIN_FUNC_SELECT(PERIPHS_IO_MUX_GPIO5_U, FUNC_GPIO5);
+	gpio_output_set(0, (1 << TRIGGER_GPIO_2), (1 << TRIGGER_GPIO_2), (1 << ECHO_GPIO_2));
+#endif
+#ifdef SENSOR_POWER_GATING
+	// the ultrasonic sensors are off until the measurement starts
+	io_sensorPower(0);
+#endif
 }
 
 // function starts the configuration button be observation
@@ -148,4 +159,19 @@ void ICACHE_FLASH_ATTR io_ledBlink(unsigned short onPeriodInMs, unsigned short o
 	// activate the timer
 	os_timer_setfn(&io_ledTimer, io_ledBlinkTimerTick, NULL);
 	os_timer_arm(&io_ledTimer, (int)onPeriodInMs, 0);
+}
+
+// function switches the supply of the ultrasonic sensors on or off; see SENSOR_POWER_GATING
+void ICACHE_FLASH_ATTR io_sensorPower(unsigned char state)
+{
+	if (state == 0)
+	{
+		// switch the sensors off
+		gpio_output_set((1 << SENSOR_POWER_GPIO), 0, (1 << SENSOR_POWER_GPIO), 0);
+	}
+	else
+	{
+		// switch the sensors on
+		gpio_output_set(0, (1 << SENSOR_POWER_GPIO), (1 << SENSOR_POWER_GPIO), 0);
+	}
 }
\ No newline at end of file
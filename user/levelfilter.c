@@ -0,0 +1,135 @@
+/*
+* ----------------------------------------------------------------------------
+* The MIT License (MIT)
+*
+* Copyright (c) 2016 - Matthias Jentsch
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+* ----------------------------------------------------------------------------
+*/
+
+#include "c_types.h"
+#include <ultrasonicmeter.h>
+#include <levelfilter.h>
+
+// one unit of the fixed point values
+#define UNITS_PER_MM DISTANCE_UNITS_PER_MM
+// the variance of the water level grows with this value per hour without a measurement; (5 mm)^2
+#define PROCESS_VARIANCE_PER_HOUR (5 * UNITS_PER_MM * 5 * UNITS_PER_MM)
+// the variance of a measurement is never smaller than this value; (2 mm)^2
+#define MIN_MEASUREMENT_VARIANCE (2 * UNITS_PER_MM * 2 * UNITS_PER_MM)
+// the filter is settled if the variance of the filtered level is not greater than this value; (3 mm)^2
+#define SETTLED_VARIANCE (3 * UNITS_PER_MM * 3 * UNITS_PER_MM)
+// a measurement that is farther away from the prediction than GATE_SIGMAS standard deviations is outside the gate
+#define GATE_SIGMAS 4
+// the gate is widened by this rate of change plus the filtered rate times the elapsed time; so a draw-down or a filling
+// that the filtered rate doesn't follow yet is corrected instead of restarting the filter; 250 mm per hour
+#define GATE_RATE_PER_HOUR (250 * UNITS_PER_MM)
+// a measurement outside the gate is skipped as outlier; this count of consecutive measurements outside the gate restarts the filter
+#define GATE_MAX_MISSES 2
+// gain for the rate of change in per mille of the level correction per elapsed time (the beta of an alpha beta filter)
+// the level correction is the innovation times the Kalman gain; so a noisy measurement hardly changes the rate
+#define RATE_GAIN_PER_MILLE 200
+// upper limit for the variance
+#define MAX_VARIANCE 0x7FFFFFFF
+
+// resets the filter state; the next measurement initializes the filter
+void ICACHE_FLASH_ATTR levelfilter_reset(LevelFilterState *pState)
+{
+	pState->level = 0;
+	pState->rate = 0;
+	pState->variance = 0;
+	pState->missCount = 0;
+}
+
+// updates the filter state with a new measurement and returns the filtered water level
+// pMeasuredLevel: the measured water level in 1/DISTANCE_UNITS_PER_MM mm
+// pDispersion: the dispersion (median absolute deviation) of the measurement in 1/DISTANCE_UNITS_PER_MM mm
+// pElapsedSeconds: seconds since the last update
+sint32 ICACHE_FLASH_ATTR levelfilter_update(LevelFilterState *pState, sint32 pMeasuredLevel, sint32 pDispersion, uint32 pElapsedSeconds)
+{
+	// the variance of the measurement; the median absolute deviation times 1.4826 is an estimate for the standard deviation
+	sint64 measurementVariance = (sint64)pDispersion * pDispersion * 22 / 10;
+	if (measurementVariance < MIN_MEASUREMENT_VARIANCE)
+	{
+		measurementVariance = MIN_MEASUREMENT_VARIANCE;
+	}
+
+	// first measurement? then initialize the filter with the measurement
+	if (pState->variance == 0)
+	{
+		pState->level = pMeasuredLevel;
+		pState->rate = 0;
+		pState->variance = (uint32)measurementVariance;
+		pState->missCount = 0;
+		return pState->level;
+	}
+
+	// predict the level and its variance
+	sint64 predictedLevel = pState->level + (sint64)pState->rate * pElapsedSeconds / 3600;
+	sint64 predictedVariance = pState->variance + (sint64)PROCESS_VARIANCE_PER_HOUR * pElapsedSeconds / 3600;
+	if (predictedVariance > MAX_VARIANCE)
+	{
+		predictedVariance = MAX_VARIANCE;
+	}
+
+	// the measurement doesn't fit to the prediction?
+	sint64 innovation = pMeasuredLevel - predictedLevel;
+	sint64 innovationVariance = predictedVariance + measurementVariance;
+	sint64 gateRate = GATE_RATE_PER_HOUR + (pState->rate < 0 ? -(sint64)pState->rate : pState->rate);
+	sint64 outside = (innovation < 0 ? -innovation : innovation) - gateRate * pElapsedSeconds / 3600;
+	if (outside > 0 && outside * outside > GATE_SIGMAS * GATE_SIGMAS * innovationVariance)
+	{
+		pState->missCount++;
+		// a jump that persists (e.g. the cistern was filled)? then restart the filter
+		if (pState->missCount >= GATE_MAX_MISSES)
+		{
+			pState->level = pMeasuredLevel;
+			pState->rate = 0;
+			pState->variance = (uint32)measurementVariance;
+			pState->missCount = 0;
+			return pState->level;
+		}
+		// otherwise skip the measurement as outlier; the filter keeps the prediction
+		pState->level = (sint32)predictedLevel;
+		pState->variance = (uint32)predictedVariance;
+		return pState->level;
+	}
+	pState->missCount = 0;
+
+	// correct the level with the Kalman gain predictedVariance / innovationVariance
+	pState->level = (sint32)(predictedLevel + innovation * predictedVariance / innovationVariance);
+	pState->variance = (uint32)(predictedVariance * measurementVariance / innovationVariance);
+	if (pState->variance == 0)
+	{
+		pState->variance = 1;
+	}
+	// correct the rate of change
+	if (pElapsedSeconds > 0)
+	{
+		pState->rate += (sint32)(innovation * predictedVariance / innovationVariance * 3600 * RATE_GAIN_PER_MILLE / 1000 / pElapsedSeconds);
+	}
+	return pState->level;
+}
+
+// delivers TRUE if the filter is initialized and its variance is small enough that a measurement with only a few shots is sufficient
+unsigned char ICACHE_FLASH_ATTR levelfilter_isSettled(const LevelFilterState *pState)
+{
+	return (pState->variance != 0 && pState->variance <= SETTLED_VARIANCE) ? TRUE : FALSE;
+}
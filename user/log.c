@@ -29,6 +29,7 @@
 #include "mem.h"
 #include "espconn.h"
 #include <espmissingincludes.h>
+#include <ultrasonicmeter.h>
 #include <powermanagement.h>
 #include <configuration.h>
 
@@ -67,7 +68,7 @@ static unsigned char ICACHE_FLASH_ATTR log_getRealFlashBlockNumber()
 	unsigned short blockNumber = log_rollingStartBlock + log_currentBlockNumber;
 	if (blockNumber >= LOG_DATA_MAX_BLOCKS)
 	{
-		blockNumber = log_currentBlockNumber - log_rollingStartBlock;
+		blockNumber -= LOG_DATA_MAX_BLOCKS;
 	}
 	return (unsigned char)(LOG_DATA_START_SEC + blockNumber);
 }
@@ -80,6 +81,13 @@ void ICACHE_FLASH_ATTR log_enable(unsigned char logType)
 	log_rollingStartBlock = (unsigned char)(nextLogBytePointer >> 24);
 	log_currentBlockNumber = (unsigned char)((nextLogBytePointer & 0x00FFFFFF) / SPI_FLASH_SEC_SIZE);
 	log_nextLogByteInBlock = (unsigned short)((nextLogBytePointer & 0x00FFFFFF) % SPI_FLASH_SEC_SIZE);
+	// a pointer of a firmware with more log blocks would address the sectors behind the log; start a new log
+	if (log_rollingStartBlock >= LOG_DATA_MAX_BLOCKS)
+	{
+		log_rollingStartBlock = 0;
+		log_currentBlockNumber = 0;
+		log_nextLogByteInBlock = 0;
+	}
 	if (log_currentBlockNumber >= LOG_DATA_MAX_BLOCKS)
 	{
 		log_isFull = TRUE;
@@ -197,7 +205,7 @@ static void ICACHE_FLASH_ATTR log_sentCallback(void * arg)
 	unsigned short blockNumber = log_rollingStartBlock + log_postBlockNumber;
 	if (blockNumber >= LOG_DATA_MAX_BLOCKS)
 	{
-		blockNumber = log_postBlockNumber - log_rollingStartBlock;
+		blockNumber -= LOG_DATA_MAX_BLOCKS;
 	}
 	blockNumber = LOG_DATA_START_SEC + blockNumber;
 	// read the next chunk from flash
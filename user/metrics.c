@@ -0,0 +1,156 @@
+/*
+* ----------------------------------------------------------------------------
+* The MIT License (MIT)
+*
+* Copyright (c) 2016 - Matthias Jentsch
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+* ----------------------------------------------------------------------------
+*/
+
+#include "c_types.h"
+#include "osapi.h"
+#include <espmissingincludes.h>
+#include <ultrasonicmeter.h>
+#include <metrics.h>
+
+// seconds per hour bucket
+#define SECONDS_PER_HOUR 3600
+// max value of one hour bucket in liters
+#define MAX_BUCKET_LITERS 0xFFFF
+
+// adds the outflow in deciliters to the bucket of the current hour
+static void ICACHE_FLASH_ATTR metrics_addConsumption(MetricsState *pState, uint32 pDeciliters)
+{
+	uint32 deciliters = pState->consumptionRemainder + pDeciliters;
+	uint32 liters = pState->consumption[pState->hourIndex] + deciliters / 10;
+	pState->consumption[pState->hourIndex] = liters > MAX_BUCKET_LITERS ? MAX_BUCKET_LITERS : (uint16)liters;
+	pState->consumptionRemainder = deciliters % 10;
+}
+
+// moves the current hour forward by the elapsed seconds; every completed hour starts a new bucket
+// the remainder below a full liter is carried into the new bucket; otherwise a slow outflow would never be counted
+static void ICACHE_FLASH_ATTR metrics_advanceTime(MetricsState *pState, uint32 pElapsedSeconds)
+{
+	uint32 seconds = pState->secondsInHour + pElapsedSeconds;
+	// after METRICS_HOURS hours all buckets are cleared anyway
+	uint32 hours = seconds / SECONDS_PER_HOUR;
+	pState->secondsInHour = seconds % SECONDS_PER_HOUR;
+	for (uint32 i = 0; i < hours && i < METRICS_HOURS; i++)
+	{
+		pState->hourIndex = (pState->hourIndex + 1) % METRICS_HOURS;
+		pState->consumption[pState->hourIndex] = 0;
+	}
+	pState->hoursCount = hours >= METRICS_HOURS - pState->hoursCount ? METRICS_HOURS : pState->hoursCount + hours;
+}
+
+// resets the metrics state; the next measurement initializes it
+void ICACHE_FLASH_ATTR metrics_reset(MetricsState *pState)
+{
+	os_memset(pState, 0, sizeof(MetricsState));
+}
+
+// updates the metrics with a new measurement; changes of the water level smaller than METRICS_DEADBAND_MM are ignored
+void ICACHE_FLASH_ATTR metrics_update(MetricsState *pState, sint32 pWaterLevel, sint32 pContent, uint32 pElapsedSeconds)
+{
+	// first measurement? then it's the reference for the next ones
+	if (pState->isInitialized == FALSE)
+	{
+		pState->referenceLevel = pWaterLevel;
+		pState->referenceContent = pContent;
+		pState->isInitialized = TRUE;
+		return;
+	}
+	pState->secondsSinceReference += pElapsedSeconds;
+
+	// the noise of the water level would sum up to a consumption; so only significant changes are counted
+	sint32 levelChange = pWaterLevel - pState->referenceLevel;
+	if (levelChange > -METRICS_DEADBAND_MM * DISTANCE_UNITS_PER_MM && levelChange < METRICS_DEADBAND_MM * DISTANCE_UNITS_PER_MM)
+	{
+		metrics_advanceTime(pState, pElapsedSeconds);
+		return;
+	}
+	sint32 contentChange = pContent - pState->referenceContent;
+	if (contentChange < 0)
+	{
+		metrics_addConsumption(pState, (uint32)-contentChange);
+	}
+	metrics_advanceTime(pState, pElapsedSeconds);
+
+	// the average rate since the last significant change is smoothed with the time constant METRICS_RATE_TIME_CONSTANT
+	if (pState->secondsSinceReference > 0)
+	{
+		sint64 rate = (sint64)contentChange * SECONDS_PER_HOUR / pState->secondsSinceReference;
+		pState->rate += (sint32)((rate - pState->rate) * pState->secondsSinceReference / (pState->secondsSinceReference + METRICS_RATE_TIME_CONSTANT));
+	}
+	pState->referenceLevel = pWaterLevel;
+	pState->referenceContent = pContent;
+	pState->secondsSinceReference = 0;
+}
+
+// gets the rate of change of the water content in deciliters per hour; positive = inflow; negative = outflow
+sint32 ICACHE_FLASH_ATTR metrics_getRate(const MetricsState *pState)
+{
+	// without a significant change for a longer time than the time constant the flow has stopped; then the rate fades out
+	if (pState->secondsSinceReference > METRICS_RATE_TIME_CONSTANT)
+	{
+		return (sint32)((sint64)pState->rate * METRICS_RATE_TIME_CONSTANT / pState->secondsSinceReference);
+	}
+	return pState->rate;
+}
+
+// gets the outflow of the last METRICS_HOURS hours in deciliters
+uint32 ICACHE_FLASH_ATTR metrics_getConsumption(const MetricsState *pState)
+{
+	uint32 liters = 0;
+	for (int i = 0; i < METRICS_HOURS; i++)
+	{
+		liters += pState->consumption[i];
+	}
+	return liters * 10 + pState->consumptionRemainder;
+}
+
+// gets the projected time in minutes until the cistern is empty; METRICS_NOT_EMPTYING if there is no outflow
+sint32 ICACHE_FLASH_ATTR metrics_getTimeToEmpty(const MetricsState *pState)
+{
+	if (pState->isInitialized == FALSE)
+	{
+		return METRICS_NOT_EMPTYING;
+	}
+	if (pState->referenceContent <= 0)
+	{
+		return 0;
+	}
+	// the outflow in deciliters per hour
+	sint32 rate = metrics_getRate(pState);
+	uint32 outflow = rate < 0 ? (uint32)-rate : 0;
+	// the average outflow needs at least one hour of data; the buckets cover the completed hours and the current one
+	uint32 seconds = (pState->hoursCount < METRICS_HOURS ? pState->hoursCount : METRICS_HOURS - 1) * SECONDS_PER_HOUR + pState->secondsInHour;
+	if (pState->hoursCount > 0)
+	{
+		uint32 averageOutflow = (uint32)((uint64)metrics_getConsumption(pState) * SECONDS_PER_HOUR / seconds);
+		outflow = averageOutflow > outflow ? averageOutflow : outflow;
+	}
+	if (outflow == 0)
+	{
+		return METRICS_NOT_EMPTYING;
+	}
+	uint64 minutes = (uint64)pState->referenceContent * 60 / outflow;
+	return minutes > 0x7FFFFFFF ? 0x7FFFFFFF : (sint32)minutes;
+}
\ No newline at end of file
@@ -27,7 +27,9 @@
 #include "user_interface.h"
 #include "osapi.h"
 #include "mem.h"
+#include "espconn.h"
 #include <espmissingincludes.h>
+#include <io.h>
 #include <ultrasonicmeter.h>
 #include <calculator.h>
 #include <powermanagement.h>
@@ -35,6 +37,7 @@
 #include <mqtt.h>
 #include <configuration.h>
 #include <log.h>
+#include <metrics.h>
 
 // Timeout timer; if the posting last too long we cancel the posting process
 static ETSTimer posting_timeoutTimer;
@@ -46,12 +49,41 @@ static int posting_mqttPublishCountdown;
 static int posting_thingspeakDone;
 // if TRUE MQTT posting is done or not needed at all
 static int posting_mqttDone;
+// if TRUE the MQTT connection is kept open for the continuous mode
+static unsigned char posting_isMqttPersistent = FALSE;
+// if TRUE the MQTT client is connected to the MQTT broker
+static unsigned char posting_isMqttConnected = FALSE;
+#ifdef BATCH_POSTING
+// TRUE if the batch is handed to the MQTT client; it's cleared when all values are published
+static unsigned char posting_isBatchPublished = FALSE;
+#endif
+#ifdef WIFI_FAST_CONNECT
+// the event handler of the caller of posting_connectWifi
+static wifi_event_handler_cb_t posting_wifiEventHandler;
+// TRUE while the module connects with the parameters of the last connection
+static unsigned char posting_isFastConnecting = FALSE;
+// falls back to the full connection if the fast connection lasts too long
+static ETSTimer posting_fastConnectTimer;
+// BSSID and channel of the access point the module is connected to; saved with the IP addresses after the IP is received
+static uint8 posting_connectedBssid[6];
+static uint8 posting_connectedChannel;
+#endif
+#ifdef MEASURE_WHILE_POSTING
+// TRUE after the measurement of the posting wake up has finished
+static unsigned char posting_isMeasurementDone = FALSE;
+// TRUE after the connection to the access point is established
+static unsigned char posting_isWifiConnected = FALSE;
+#endif
 
 // callback if the timeout timer is elapsed
 static void ICACHE_FLASH_ATTR posting_timeoutTimerTick(void *arg)
 {
 	os_printf("Sending the data lasts too long! Canceling ...\n");
 	os_timer_disarm(&posting_timeoutTimer);
+#ifdef WIFI_FAST_CONNECT
+	// maybe the saved IP is taken by another device; use DHCP next time
+	powermanagement_getWifiConnectionCache()->channel = 0;
+#endif
 	powermanagement_postingCanceled();
 	powermanagement_deepSleep();
 }
@@ -75,32 +107,187 @@ static void ICACHE_FLASH_ATTR posting_finished(char * response, int http_status,
 	}
 }
 
-// called after the MQTT client is connected to the MQTT broker
-static void ICACHE_FLASH_ATTR posting_mqttClientConnected(uint32_t *args)
+// builds the MQTT topic <topic>/<suffix> of the cistern of the channel
+// the first cistern is published directly under the topic; the others under <topic>/<channel>
+static void ICACHE_FLASH_ATTR posting_buildChannelTopic(char *topic, int channel, const char *suffix)
+{
+	if (channel == 0)
+	{
+		os_sprintf(topic, "%s/%s", configuration_getMqttTopic(), suffix);
+	}
+	else
+	{
+		os_sprintf(topic, "%s/%d/%s", configuration_getMqttTopic(), channel, suffix);
+	}
+}
+
+// publishes all three water level values of all cisterns; see calculator_calculateNewValues
+static void ICACHE_FLASH_ATTR posting_mqttPublishValues(MQTT_Client* client)
 {
 	char topic[256];
 	char data[256];
 	
-	MQTT_Client* client = (MQTT_Client*)args;
-	os_printf("MQTT: Client connected!\n");
+	for (int i = 0; i < ULTRASONIC_CHANNEL_COUNT; i++)
+	{
+		posting_buildChannelTopic(topic, i, "centimeter");
+		os_sprintf(data, "%d", (int)calculator_getCentimeter(i));
+		os_printf("MQTT: Publishing %s => %s\n", topic, data);
+		MQTT_Publish(client, topic, data, strlen(data), 0, TRUE);
+		
+		posting_buildChannelTopic(topic, i, "liter");
+		os_sprintf(data, "%d", (int)calculator_getLiter(i));
+		os_printf("MQTT: Publishing %s => %s\n", topic, data);
+		MQTT_Publish(client, topic, data, strlen(data), 0, TRUE);
 
-	// publish all three water level values
-	posting_mqttPublishCountdown = 3;
+		posting_buildChannelTopic(topic, i, "percent");
+		os_sprintf(data, "%d", (int)calculator_getPercent(i));
+		os_printf("MQTT: Publishing %s => %s\n", topic, data);
+		MQTT_Publish(client, topic, data, strlen(data), 0, TRUE);
+	}
+}
 
-	os_sprintf(topic, "%s/centimeter", configuration_getMqttTopic());
-	os_sprintf(data, "%d", (int)calculator_getCentimeter());
-	os_printf("MQTT: Publishing %s => %s\n", topic, data);
-	MQTT_Publish(client, topic, data, strlen(data), 0, TRUE);
-	
-	os_sprintf(topic, "%s/liter", configuration_getMqttTopic());
-	os_sprintf(data, "%d", (int)calculator_getLiter());
-	os_printf("MQTT: Publishing %s => %s\n", topic, data);
-	MQTT_Publish(client, topic, data, strlen(data), 0, TRUE);
+#ifdef MQTT_PUBLISH_QUALITY
+// publishes the quality of the last measurement cycle of all cisterns as JSON; see MeasurementQuality
+static void ICACHE_FLASH_ATTR posting_mqttPublishQuality(MQTT_Client* client)
+{
+	char topic[256];
+	char data[256];
+
+	for (int i = 0; i < ULTRASONIC_CHANNEL_COUNT; i++)
+	{
+		const MeasurementQuality *quality = powermanagement_getMeasurementQuality(i);
+		posting_buildChannelTopic(topic, i, "quality");
+		os_sprintf(data, "{\"Shots\":%d,\"Valid\":%d,\"Lost\":%d,\"OutOfRange\":%d,\"Spread\":%d.%d,\"Jitter\":%d.%d,\"FirstEcho\":%d}",
+			quality->shotCount, quality->validCount, quality->lostCount, quality->outOfRangeCount,
+			quality->spread / DISTANCE_UNITS_PER_MM, quality->spread % DISTANCE_UNITS_PER_MM,
+			quality->jitter / DISTANCE_UNITS_PER_MM, quality->jitter % DISTANCE_UNITS_PER_MM,
+			quality->timeToFirstEcho == QUALITY_NO_ECHO_TIME ? -1 : quality->timeToFirstEcho);
+		os_printf("MQTT: Publishing %s => %s\n", topic, data);
+		MQTT_Publish(client, topic, data, strlen(data), 0, TRUE);
+	}
+}
+#endif
+
+#ifdef BATCH_POSTING
+// publishes the batch of the measurements of all cisterns as JSON array [[<seconds before posting>, <water level in mm>], ...]; the oldest first
+// returns FALSE if the batch isn't published; then it's kept for the next post
+static unsigned char ICACHE_FLASH_ATTR posting_mqttPublishBatch(MQTT_Client* client)
+{
+	char topic[256];
+	unsigned int ages[BATCH_MAX_POINTS];
+	unsigned char count = powermanagement_getBatchPointCount();
+	unsigned int secondsSincePrevious;
+	sint32 waterLevel;
+	// two numbers with up to 5 digits per measurement
+	char *data = (char*)os_malloc(BATCH_MAX_POINTS * 16 + 3);
+
+	if (data == NULL)
+	{
+		os_printf("MQTT: No memory for the batch\n");
+		return FALSE;
+	}
+	// the times are relative to the measurement before; so the ages are summed up from the newest one
+	if (count > 0)
+	{
+		ages[count - 1] = powermanagement_getSecondsSinceBatchPoint();
+		for (int j = count - 1; j > 0; j--)
+		{
+			powermanagement_getBatchPoint(j, 0, &secondsSincePrevious, &waterLevel);
+			ages[j - 1] = ages[j] + secondsSincePrevious;
+		}
+	}
+	for (int i = 0; i < ULTRASONIC_CHANNEL_COUNT; i++)
+	{
+		posting_buildChannelTopic(topic, i, "batch");
+		os_strcpy(data, "[");
+		for (int j = 0; j < count; j++)
+		{
+			powermanagement_getBatchPoint(j, i, &secondsSincePrevious, &waterLevel);
+			os_sprintf(data + os_strlen(data), j == 0 ? "[%d,%d]" : ",[%d,%d]", ages[j], (int)(waterLevel / DISTANCE_UNITS_PER_MM));
+		}
+		os_strcpy(data + os_strlen(data), "]");
+		os_printf("MQTT: Publishing %s => %s\n", topic, data);
+		MQTT_Publish(client, topic, data, strlen(data), 0, TRUE);
+	}
+	os_free(data);
+	return TRUE;
+}
+#endif
+
+#ifdef DERIVED_METRICS
+// publishes the derived metrics of all cisterns; see metrics.h
+static void ICACHE_FLASH_ATTR posting_mqttPublishMetrics(MQTT_Client* client)
+{
+	char topic[256];
+	char data[32];
+
+	for (int i = 0; i < ULTRASONIC_CHANNEL_COUNT; i++)
+	{
+		posting_buildChannelTopic(topic, i, "flow");
+		os_sprintf(data, "%d", (int)(powermanagement_getFlowRate(i) / 10));
+		os_printf("MQTT: Publishing %s => %s\n", topic, data);
+		MQTT_Publish(client, topic, data, strlen(data), 0, TRUE);
+
+		posting_buildChannelTopic(topic, i, "consumption");
+		os_sprintf(data, "%d", (int)(powermanagement_getConsumption(i) / 10));
+		os_printf("MQTT: Publishing %s => %s\n", topic, data);
+		MQTT_Publish(client, topic, data, strlen(data), 0, TRUE);
 
-	os_sprintf(topic, "%s/percent", configuration_getMqttTopic());
-	os_sprintf(data, "%d", (int)calculator_getPercent());
-	os_printf("MQTT: Publishing %s => %s\n", topic, data);
-	MQTT_Publish(client, topic, data, strlen(data), 0, TRUE);
+		posting_buildChannelTopic(topic, i, "timetoempty");
+		os_sprintf(data, "%d", (int)powermanagement_getTimeToEmpty(i));
+		os_printf("MQTT: Publishing %s => %s\n", topic, data);
+		MQTT_Publish(client, topic, data, strlen(data), 0, TRUE);
+	}
+}
+
+// updates the derived metrics of the cistern of the channel with the water level in 1/DISTANCE_UNITS_PER_MM mm
+static void ICACHE_FLASH_ATTR posting_updateMetrics(unsigned char pChannel, sint32 pWaterLevel)
+{
+	calculator_calculateNewValues(pChannel, pWaterLevel);
+	// the metrics are derived from the content; an invalid content would look like an emptied cistern
+	if (calculator_isContentCalculated(pChannel) == FALSE)
+	{
+		return;
+	}
+	powermanagement_updateMetrics(pChannel, pWaterLevel, (sint32)(calculator_getLiter(pChannel) * 10.0));
+	os_printf("Flow = %d l/h; Consumption = %d l; Time to empty = %d min\n", (int)(powermanagement_getFlowRate(pChannel) / 10),
+		(int)(powermanagement_getConsumption(pChannel) / 10), (int)powermanagement_getTimeToEmpty(pChannel));
+}
+#endif
+
+// called after the MQTT client is connected to the MQTT broker
+static void ICACHE_FLASH_ATTR posting_mqttClientConnected(uint32_t *args)
+{
+	MQTT_Client* client = (MQTT_Client*)args;
+	os_printf("MQTT: Client connected!\n");
+	posting_isMqttConnected = TRUE;
+	// in the continuous mode the values are published by posting_publishContinuous
+	if (posting_isMqttPersistent == TRUE)
+	{
+		return;
+	}
+
+	// publish all three water level values of all cisterns
+	posting_mqttPublishCountdown = 3 * ULTRASONIC_CHANNEL_COUNT;
+	posting_mqttPublishValues(client);
+#ifdef MQTT_PUBLISH_QUALITY
+	// and the quality of the last measurement cycle
+	posting_mqttPublishCountdown += ULTRASONIC_CHANNEL_COUNT;
+	posting_mqttPublishQuality(client);
+#endif
+#ifdef DERIVED_METRICS
+	// and the derived metrics
+	posting_mqttPublishCountdown += 3 * ULTRASONIC_CHANNEL_COUNT;
+	posting_mqttPublishMetrics(client);
+#endif
+#ifdef BATCH_POSTING
+	// and the measurements since the last posting
+	posting_isBatchPublished = posting_mqttPublishBatch(client);
+	if (posting_isBatchPublished == TRUE)
+	{
+		posting_mqttPublishCountdown += ULTRASONIC_CHANNEL_COUNT;
+	}
+#endif
 }
 
 // called after the MQTT client has published one value
@@ -108,6 +295,11 @@ static void ICACHE_FLASH_ATTR posting_mqttPublished(uint32_t *args)
 {
 	MQTT_Client* client = (MQTT_Client*)args;
 	os_printf("MQTT: Published\n");
+	// keep the connection open in the continuous mode
+	if (posting_isMqttPersistent == TRUE)
+	{
+		return;
+	}
 	// one value published; all values published?
 	posting_mqttPublishCountdown--;
 	if (posting_mqttPublishCountdown == 0)
@@ -141,9 +333,21 @@ static void ICACHE_FLASH_ATTR posting_mqttDataReceived(uint32_t *args, const cha
 static void ICACHE_FLASH_ATTR posting_mqttClientDisconnected(uint32_t *args)
 {
 	os_printf("MQTT: Client disconnected!\n");
+	posting_isMqttConnected = FALSE;
+	// in the continuous mode the MQTT client reconnects by itself
+	if (posting_isMqttPersistent == TRUE)
+	{
+		return;
+	}
 	if (posting_mqttPublishCountdown == 0)
 	{
 		powermanagement_measurementPosted();
+#ifdef BATCH_POSTING
+		if (posting_isBatchPublished == TRUE)
+		{
+			powermanagement_batchPosted();
+		}
+#endif
 	}
 	// go to sleep if also the Thingspeak posting has finished
 	posting_mqttDone = TRUE;
@@ -159,7 +363,8 @@ void ICACHE_FLASH_ATTR posting_initializeMqtt()
 	// MQTT connection configuration
 	MQTT_InitConnection(&posting_mqttClient, configuration_getMqttServer(), configuration_getMqttPort(), FALSE);
 	// MQTT client configuration
-	MQTT_InitClient(&posting_mqttClient, configuration_getMqttClientName(), configuration_getMqttUsername(), configuration_getMqttPassword(), 0, TRUE);
+	MQTT_InitClient(&posting_mqttClient, configuration_getMqttClientName(), configuration_getMqttUsername(), configuration_getMqttPassword(),
+		posting_isMqttPersistent == TRUE ? CONTINUOUS_MQTT_KEEPALIVE : 0, TRUE);
 	// set callbacks
 	MQTT_OnConnected(&posting_mqttClient, posting_mqttClientConnected);
 	MQTT_OnDisconnected(&posting_mqttClient, posting_mqttClientDisconnected);
@@ -167,6 +372,236 @@ void ICACHE_FLASH_ATTR posting_initializeMqtt()
 	MQTT_OnData(&posting_mqttClient, posting_mqttDataReceived);
 }
 
+// initialize MQTT part for the continuous mode; the connection is kept open and reconnected if it's lost
+void ICACHE_FLASH_ATTR posting_initializeContinuousMqtt()
+{
+	posting_isMqttPersistent = TRUE;
+	posting_initializeMqtt();
+}
+
+// connects to the MQTT broker; in the continuous mode the connection is kept open
+void ICACHE_FLASH_ATTR posting_connectMqtt()
+{
+	MQTT_Connect(&posting_mqttClient);
+}
+
+// publishes the water levels of all cisterns in 1/DISTANCE_UNITS_PER_MM mm over the open MQTT connection of the continuous mode
+// returns FALSE if the MQTT client isn't connected
+unsigned char ICACHE_FLASH_ATTR posting_publishContinuous(const sint32 *pWaterLevels)
+{
+	if (posting_isMqttConnected == FALSE)
+	{
+		return FALSE;
+	}
+	for (int i = 0; i < ULTRASONIC_CHANNEL_COUNT; i++)
+	{
+		calculator_calculateNewValues(i, pWaterLevels[i]);
+	}
+	posting_mqttPublishValues(&posting_mqttClient);
+	return TRUE;
+}
+
+#ifdef WIFI_FAST_CONNECT
+// the fast connection with the parameters of the last connection has failed; connects with scan and DHCP
+static void ICACHE_FLASH_ATTR posting_fastConnectFailed(void *arg)
+{
+	struct station_config stationConf;
+	os_printf("Fast connect failed! Scanning ...\n");
+	os_timer_disarm(&posting_fastConnectTimer);
+	posting_isFastConnecting = FALSE;
+	powermanagement_getWifiConnectionCache()->channel = 0;
+	wifi_station_disconnect();
+	os_memset(&stationConf, 0, sizeof(struct station_config));
+	os_sprintf(stationConf.ssid, configuration_getWifiSsid());
+	os_sprintf(stationConf.password, configuration_getWifiPassword());
+	wifi_station_set_config_current(&stationConf);
+	wifi_station_dhcpc_start();
+	wifi_station_connect();
+}
+
+// called on Wifi events; saves the parameters of the connection and falls back to the full connection before the caller gets the event
+static void ICACHE_FLASH_ATTR posting_wifiEvent(System_Event_t *evt)
+{
+	WifiConnectionCache *cache = powermanagement_getWifiConnectionCache();
+	struct ip_info ipInfo;
+
+	switch (evt->event)
+	{
+	case EVENT_STAMODE_CONNECTED:
+		os_memcpy(posting_connectedBssid, evt->event_info.connected.bssid, sizeof(posting_connectedBssid));
+		posting_connectedChannel = evt->event_info.connected.channel;
+		break;
+
+	case EVENT_STAMODE_DISCONNECTED:
+		// the access point or its channel has changed
+		if (posting_isFastConnecting == TRUE)
+		{
+			posting_fastConnectFailed(NULL);
+			return;
+		}
+		break;
+
+	case EVENT_STAMODE_GOT_IP:
+		if (posting_isFastConnecting == TRUE)
+		{
+			os_timer_disarm(&posting_fastConnectTimer);
+			posting_isFastConnecting = FALSE;
+			cache->useCount++;
+		}
+		// the IP is from the DHCP server; save it for the next wake up
+		else if (wifi_get_ip_info(STATION_IF, &ipInfo) == TRUE)
+		{
+			os_memcpy(cache->bssid, posting_connectedBssid, sizeof(cache->bssid));
+			cache->channel = posting_connectedChannel;
+			cache->useCount = 0;
+			cache->ip = ipInfo.ip.addr;
+			cache->netmask = ipInfo.netmask.addr;
+			cache->gateway = ipInfo.gw.addr;
+			cache->dns = espconn_dns_getserver(0).addr;
+		}
+		break;
+	}
+	posting_wifiEventHandler(evt);
+}
+#endif
+
+// connects to the access point of the configuration; the event handler is called after the connection is established
+void ICACHE_FLASH_ATTR posting_connectWifi(wifi_event_handler_cb_t pEventHandler)
+{
+	struct station_config stationConf;
+	wifi_set_opmode_current(STATION_MODE);
+	os_memset(&stationConf, 0, sizeof(struct station_config));
+	os_sprintf(stationConf.ssid, configuration_getWifiSsid());
+	os_sprintf(stationConf.password, configuration_getWifiPassword());
+#ifdef WIFI_FAST_CONNECT
+	// connect without scan and DHCP to the access point of the last connection; the lease of the IP is renewed from time to time
+	WifiConnectionCache *cache = powermanagement_getWifiConnectionCache();
+	posting_isFastConnecting = cache->channel != 0 && cache->useCount < WIFI_FAST_CONNECT_MAX_USES;
+	if (posting_isFastConnecting == TRUE)
+	{
+		struct ip_info ipInfo;
+		ip_addr_t dns;
+		os_printf("Fast connect on channel %d ...\n", cache->channel);
+		stationConf.bssid_set = 1;
+		os_memcpy(stationConf.bssid, cache->bssid, sizeof(stationConf.bssid));
+		wifi_set_channel(cache->channel);
+		wifi_station_dhcpc_stop();
+		ipInfo.ip.addr = cache->ip;
+		ipInfo.netmask.addr = cache->netmask;
+		ipInfo.gw.addr = cache->gateway;
+		wifi_set_ip_info(STATION_IF, &ipInfo);
+		dns.addr = cache->dns;
+		espconn_dns_setserver(0, &dns);
+		os_timer_disarm(&posting_fastConnectTimer);
+		os_timer_setfn(&posting_fastConnectTimer, posting_fastConnectFailed, NULL);
+		os_timer_arm(&posting_fastConnectTimer, WIFI_FAST_CONNECT_TIMEOUT, 0);
+	}
+	posting_wifiEventHandler = pEventHandler;
+	wifi_station_set_config_current(&stationConf);
+	wifi_set_event_handler_cb(posting_wifiEvent);
+#else
+	wifi_station_set_config_current(&stationConf);
+	wifi_set_event_handler_cb(pEventHandler);
+#endif
+	wifi_station_connect();
+}
+
+// posts the saved water levels of all cisterns; the module is connected to the access point
+static void ICACHE_FLASH_ATTR posting_postMeasurement()
+{
+	os_printf("Ready to send the data!\n");
+	wifi_station_set_hostname(configuration_getHostname());
+
+	for (int i = 0; i < ULTRASONIC_CHANNEL_COUNT; i++)
+	{
+		calculator_calculateNewValues(i, powermanagement_getLastMeasurement(i));
+	}
+
+	posting_thingspeakDone = configuration_shouldPostToThingspeak() ? FALSE : TRUE;
+	posting_mqttDone = configuration_shouldPostToMqtt() ? FALSE : TRUE;
+	
+	// If needed: Send data to Thingspeak
+	if (configuration_shouldPostToThingspeak() == TRUE)
+	{
+		os_printf("Sending to Thingspeak...\n");
+		char url[256];
+		os_sprintf(url, THINGSPEAK_URL, configuration_getThingspeakServerUrl(), configuration_getThingspeakApiKey(), (int)calculator_getCentimeter(0), (int)calculator_getLiter(0), (int)calculator_getPercent(0));
+#if ULTRASONIC_CHANNEL_COUNT > 1
+		os_sprintf(url + os_strlen(url), THINGSPEAK_URL_SECOND_CISTERN, (int)calculator_getCentimeter(1), (int)calculator_getLiter(1), (int)calculator_getPercent(1));
+#endif
+		os_printf("%s\n", url);
+		http_get(url, "", posting_finished);
+	}
+	// If needed: Send data to MQTT broker
+	if (configuration_shouldPostToMqtt() == TRUE)
+	{
+		os_printf("Sending to MQTT broker...\n");
+		MQTT_Connect(&posting_mqttClient);
+	}
+
+	// now we are connected to the internet! => post also the log data
+	log_post();
+}
+
+#ifdef MEASURE_WHILE_POSTING
+// called after the measurement of the posting wake up is finished; the fresh water levels replace the saved ones
+// posts them if the module is already connected to the access point
+static void ICACHE_FLASH_ATTR posting_measurementFinished()
+{
+#ifdef BATCH_POSTING
+	sint32 waterLevels[ULTRASONIC_CHANNEL_COUNT];
+	unsigned char isFresh = FALSE;
+#endif
+
+	for (int i = 0; i < ULTRASONIC_CHANNEL_COUNT; i++)
+	{
+		MeasurementQuality quality;
+		ultrasonicMeter_getQuality(i, &quality);
+		powermanagement_setMeasurementQuality(i, &quality);
+		// without a valid shot the saved water level is posted
+		if (quality.validCount > 0)
+		{
+			sint32 waterLevel = ultrasonicMeter_getWaterLevel(i);
+#ifdef LEVEL_FILTER
+			waterLevel = powermanagement_filterMeasurement(i, waterLevel, ultrasonicMeter_getDispersion(i));
+#endif
+			powermanagement_setLastMeasurement(i, waterLevel);
+			os_printf("Fresh water level[%d] = %d mm\n", i, (int)(waterLevel / DISTANCE_UNITS_PER_MM));
+#ifdef DERIVED_METRICS
+			posting_updateMetrics(i, waterLevel);
+#endif
+#ifdef BATCH_POSTING
+			isFresh = TRUE;
+#endif
+		}
+#ifdef BATCH_POSTING
+		waterLevels[i] = powermanagement_getLastMeasurement(i);
+#endif
+	}
+#ifdef BATCH_POSTING
+	// the batch ends with the posted water levels; powermanagement_checkCurrentMeasurement keeps a place free for them
+	if (isFresh == TRUE)
+	{
+		powermanagement_addBatchPoint(waterLevels);
+	}
+#endif
+	// the shots have pulsed the led; it's on while posting
+	io_ledSet(1);
+	posting_isMeasurementDone = TRUE;
+	if (posting_isWifiConnected == TRUE)
+	{
+		posting_postMeasurement();
+	}
+}
+
+// starts the measurement of the posting wake up; runs while the module connects to the access point
+void ICACHE_FLASH_ATTR posting_startMeasurement()
+{
+	ultrasonicMeter_setMaxShots(MEASURE_WHILE_POSTING_SHOTS);
+	ultrasonicMeter_startMeasurement(posting_measurementFinished, FALSE);
+}
+#endif
+
 // called after the connection to the access point is finished; starts the posting of the data via http client
 void ICACHE_FLASH_ATTR posting_start(System_Event_t *evt)
 {
@@ -176,32 +611,21 @@ void ICACHE_FLASH_ATTR posting_start(System_Event_t *evt)
 	{
 		if (powermanagement_shouldPostMeasurement() == TRUE)
 		{
-			os_printf("Ready to send the data!\n");
-			wifi_station_set_hostname(configuration_getHostname());
-
-			calculator_calculateNewValues(powermanagement_getLastMeasurement());
-
-			posting_thingspeakDone = configuration_shouldPostToThingspeak() ? FALSE : TRUE;
-			posting_mqttDone = configuration_shouldPostToMqtt() ? FALSE : TRUE;
-			
-			// If needed: Send data to Thingspeak
-			if (configuration_shouldPostToThingspeak() == TRUE)
+#ifdef MEASURE_WHILE_POSTING
+			// got the IP again after a reconnect? the data is already posted
+			if (posting_isWifiConnected == TRUE)
 			{
-				os_printf("Sending to Thingspeak...\n");
-				char url[256];
-				os_sprintf(url, THINGSPEAK_URL, configuration_getThingspeakServerUrl(), configuration_getThingspeakApiKey(), (int)calculator_getCentimeter(), (int)calculator_getLiter(), (int)calculator_getPercent());
-				os_printf("%s\n", url);
-				http_get(url, "", posting_finished);
+				return;
 			}
-			// If needed: Send data to MQTT broker
-			if (configuration_shouldPostToMqtt() == TRUE)
+			posting_isWifiConnected = TRUE;
+			// the measurement posts the data when it's finished
+			if (posting_isMeasurementDone == FALSE)
 			{
-				os_printf("Sending to MQTT broker...\n");
-				MQTT_Connect(&posting_mqttClient);
+				os_printf("Waiting for the measurement ...\n");
+				return;
 			}
-
-			// now we are connected to the internet! => post also the log data
-			log_post();
+#endif
+			posting_postMeasurement();
 		}
 		else if (powermanagement_shouldPostLog() == TRUE)
 		{
@@ -219,16 +643,67 @@ void ICACHE_FLASH_ATTR posting_startTimeoutTimer()
 	os_timer_arm(&posting_timeoutTimer, POST_MEASUREMENT_TIMEOUT * 1000, 0);
 }
 
+#ifdef FORCED_MODEM_SLEEP
+// posts the checked measurement in this wake up instead of activating the modem with one more deep sleep cycle
+// the modem was powered down by the forced modem sleep
+static void ICACHE_FLASH_ATTR posting_postInThisWakeUp()
+{
+	os_printf("\nWaking up the modem ...\n");
+	wifi_fpm_do_wakeup();
+	wifi_fpm_close();
+	io_ledSet(1);
+#ifdef MEASURE_WHILE_POSTING
+	// the measurement was just done
+	posting_isMeasurementDone = TRUE;
+#endif
+	posting_connectWifi(posting_start);
+	if (configuration_shouldPostToMqtt() == TRUE)
+	{
+		posting_initializeMqtt();
+	}
+	posting_startTimeoutTimer();
+}
+#endif
+
 // called after the ultrasonic measurement is finished; checks if the date should pe posted
 void ICACHE_FLASH_ATTR posting_checkIfPostNeeded()
 {
+	sint32 waterLevels[ULTRASONIC_CHANNEL_COUNT];
+
 	os_printf("Measurement finished!\n");
-	float waterLevel = ultrasonicMeter_getWaterLevel();
-	os_printf("Water level = %d mm\n", (int)waterLevel);
-	os_printf("Quality = %d\n", ultrasonicMeter_getEchoQuality());
-	if (powermanagement_checkCurrentMeasurement(waterLevel) == TRUE)
+	for (int i = 0; i < ULTRASONIC_CHANNEL_COUNT; i++)
+	{
+		waterLevels[i] = ultrasonicMeter_getWaterLevel(i);
+		os_printf("Water level[%d] = %d mm\n", i, (int)(waterLevels[i] / DISTANCE_UNITS_PER_MM));
+		MeasurementQuality quality;
+		ultrasonicMeter_getQuality(i, &quality);
+		powermanagement_setMeasurementQuality(i, &quality);
+		os_printf("Quality: Valid = %d; Lost = %d; Out of range = %d; First echo after %d ms\n", quality.validCount, quality.lostCount,
+			quality.outOfRangeCount, quality.timeToFirstEcho);
+		os_printf("Shots = %d; Spread = %d mm; Dispersion = %d/%d mm\n", ultrasonicMeter_getShotCount(i), (int)(ultrasonicMeter_getSpread(i) / DISTANCE_UNITS_PER_MM),
+			(int)ultrasonicMeter_getDispersion(i), DISTANCE_UNITS_PER_MM);
+#ifdef LEVEL_FILTER
+		// only a measurement with valid shots updates the level filter
+		if (ultrasonicMeter_getValidShotCount(i) > 0)
+		{
+			waterLevels[i] = powermanagement_filterMeasurement(i, waterLevels[i], ultrasonicMeter_getDispersion(i));
+			os_printf("Filtered water level = %d mm; Rate = %d mm/h\n", (int)(waterLevels[i] / DISTANCE_UNITS_PER_MM), (int)(powermanagement_getLevelRate(i) / DISTANCE_UNITS_PER_MM));
+		}
+#endif
+#ifdef DERIVED_METRICS
+		if (quality.validCount > 0)
+		{
+			posting_updateMetrics(i, waterLevels[i]);
+		}
+#endif
+	}
+	if (powermanagement_checkCurrentMeasurement(waterLevels) == TRUE)
 	{
 		os_printf("\nData should be send!\n");
+#ifdef FORCED_MODEM_SLEEP
+		posting_postInThisWakeUp();
+		return;
+#endif
 	}
 	else
 	{
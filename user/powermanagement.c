@@ -26,57 +26,144 @@
 
 #include "osapi.h"
 #include "user_interface.h"
-#include "math.h"
 #include <espmissingincludes.h>
 #include <io.h>
 #include <configuration.h>
+#include <ultrasonicmeter.h>
+#include <levelfilter.h>
+#include <metrics.h>
 #include <log.h>
 #include <powermanagement.h>
 
-// the magic number to check if the data in rtc memory is valid
-#define RTC_MAGIC 0x5aa5
+// the magic number to check if the data in rtc memory is valid; change it if the layout of DeepSleepSurvivalData changes
+#define RTC_MAGIC 0x5aae
 // const for invalid water level
-#define LAST_MEASURED_WATER_LEVEL_INVALID -10000.0
+#define LAST_MEASURED_WATER_LEVEL_INVALID (-10000 * DISTANCE_UNITS_PER_MM)
 // start address for the data structure in RTC memory; start of user data
 #define RTC_DATA_ADDRESS 64
+#ifdef FORCED_MODEM_SLEEP
+// the measurement wake up has the modem but without RF calibration; it's powered down by the forced modem sleep until a post is needed
+#define MEASUREMENT_DEEP_SLEEP_OPTION 2
+#else
+// the measurement wake up has no modem
+#define MEASUREMENT_DEEP_SLEEP_OPTION 4
+#endif
 
-// data that will be stored into the RTC memory; this data survice the deep sleep
+#ifdef BATCH_POSTING
+#ifdef MEASURE_WHILE_POSTING
+// the batch is posted one measurement before it's full; the place is kept free for the fresh measurement of the posting wake up
+#define BATCH_POST_POINTS (BATCH_MAX_POINTS - 1)
+#else
+#define BATCH_POST_POINTS BATCH_MAX_POINTS
+#endif
+// one measurement in the batch of the measurements that are posted together
+typedef struct
+{
+	unsigned short secondsSincePrevious;	// seconds since the measurement before; the time of the first one is relative to the one before that was overwritten
+	unsigned short waterLevel[ULTRASONIC_CHANNEL_COUNT];	// the water level per ultrasonic sensor channel in millimeters
+} BatchPoint;
+#endif
+
+// data that will be stored into the RTC memory (512 bytes max); this data survice the deep sleep
 typedef struct
 {
 	unsigned short magic;	// if not DEEP_SLEEP_IS_INITIALIZED then the data in the struct is not valid
-	float lastMeasuredWaterLevel;	// the last measured water level in mm
+	sint32 lastMeasuredWaterLevel[ULTRASONIC_CHANNEL_COUNT];	// the last measured water level per ultrasonic sensor channel in 1/DISTANCE_UNITS_PER_MM mm
 	unsigned short postUnchangedMeasurementCountDown;	// the water level was posted to the internet this amount of seconds before
 	unsigned char shoudlEnterConfigurationMode; // set to TRUE if the configuration mode should be entered
 	unsigned char shouldDoMeasurement;	// set to TRUE if the program should do a water level measurement; and don't post the data to the internet
 	unsigned char shouldPostMeasurement;	// set to TRUE if the program should post the measured data to the internet; and don't do a water level measurement
 	unsigned char shouldPostLog;	// set to TRUE if the program should post the log data to the internet; and don't do a water level measurement
 	unsigned int nextLogBytePointer;	// points to the next log byte; relative to the beginning of the log; starts with 0
+	unsigned int secondsSinceLevelFilterUpdate[ULTRASONIC_CHANNEL_COUNT];	// seconds (deep sleep and awake time) since the last update of the level filter per channel
+	LevelFilterState levelFilter[ULTRASONIC_CHANNEL_COUNT];	// state of the level filter per channel that combines the measurements of several wake ups
+	unsigned short sensorSettleTime;	// tuned settle time of the ultrasonic sensors after switching them on in milliseconds; 0 = not tuned yet
+	MeasurementQuality measurementQuality[ULTRASONIC_CHANNEL_COUNT];	// quality of the last measurement cycle per channel
+#ifdef DERIVED_METRICS
+	unsigned int secondsSinceMetricsUpdate[ULTRASONIC_CHANNEL_COUNT];	// seconds (deep sleep and awake time) since the last update of the metrics per channel
+	MetricsState metrics[ULTRASONIC_CHANNEL_COUNT];	// state of the derived metrics per channel
+#endif
+#ifdef BATCH_POSTING
+	unsigned int secondsSinceBatchPoint;	// seconds (deep sleep and awake time) since the last measurement was added to the batch
+	unsigned char batchStart;	// index of the oldest measurement in batch
+	unsigned char batchCount;	// count of the measurements in batch
+	BatchPoint batch[BATCH_MAX_POINTS];	// ring buffer of the measurements that are not posted yet
+#endif
+#ifdef WIFI_FAST_CONNECT
+	WifiConnectionCache wifiConnectionCache;	// the parameters of the last connection to the access point
+#endif
 } DeepSleepSurvivalData;
 
+// the user data of the RTC memory has 512 bytes from RTC_DATA_ADDRESS on; the build fails if the data doesn't fit
+typedef char powermanagement_dataSizeCheck[sizeof(DeepSleepSurvivalData) <= 512 ? 1 : -1];
+
 // the instance of the data
 static DeepSleepSurvivalData powermanagement_data;
+// awake time in seconds of this wake up when the level filter of the channel was updated; 0 if it wasn't updated in this wake up
+static unsigned int powermanagement_levelFilterAwakeSeconds[ULTRASONIC_CHANNEL_COUNT];
+#ifdef DERIVED_METRICS
+// awake time in seconds of this wake up when the metrics of the channel were updated; 0 if they weren't updated in this wake up
+static unsigned int powermanagement_metricsAwakeSeconds[ULTRASONIC_CHANNEL_COUNT];
+#endif
+#ifdef BATCH_POSTING
+// awake time in seconds of this wake up when the newest measurement was added to the batch; 0 if none was added in this wake up
+static unsigned int powermanagement_batchPointAwakeSeconds = 0;
+#endif
+
+// saves the log and the data structure into RTC memory; the data survives the following deep sleep
+static void ICACHE_FLASH_ATTR powermanagement_saveData()
+{
+	log_save();
+	// a failed write leaves the old data; it's detected by the magic number or used like after a failed wake up
+	if (system_rtc_mem_write(RTC_DATA_ADDRESS, &powermanagement_data, sizeof(powermanagement_data)) == FALSE)
+	{
+		os_printf("RTC memory write failed\n");
+	}
+}
 
 // read the data structure from RTC memory or init the data if the data in RTC memory is not valid
 unsigned char ICACHE_FLASH_ATTR powermanagement_readOrInitData()
 {
 	// read from rtc memory and test if data is valid
-	system_rtc_mem_read(RTC_DATA_ADDRESS, &powermanagement_data, sizeof(powermanagement_data));
+	if (system_rtc_mem_read(RTC_DATA_ADDRESS, &powermanagement_data, sizeof(powermanagement_data)) == FALSE)
+	{
+		os_printf("RTC memory read failed\n");
+		powermanagement_data.magic = 0;
+	}
 	if (powermanagement_data.magic != RTC_MAGIC)
 	{
 		// data not valid! create new data
 		powermanagement_data.magic = RTC_MAGIC;
-		powermanagement_data.lastMeasuredWaterLevel = LAST_MEASURED_WATER_LEVEL_INVALID;
 		powermanagement_data.postUnchangedMeasurementCountDown = 0;
 		powermanagement_data.shoudlEnterConfigurationMode = FALSE;
 		powermanagement_data.shouldDoMeasurement = TRUE;
 		powermanagement_data.shouldPostMeasurement = FALSE;
 		powermanagement_data.shouldPostLog = FALSE;
 		powermanagement_data.nextLogBytePointer = 0;
+		powermanagement_data.sensorSettleTime = 0;
+		os_memset(powermanagement_data.measurementQuality, 0, sizeof(powermanagement_data.measurementQuality));
+#ifdef WIFI_FAST_CONNECT
+		os_memset(&powermanagement_data.wifiConnectionCache, 0, sizeof(powermanagement_data.wifiConnectionCache));
+#endif
+#ifdef BATCH_POSTING
+		powermanagement_data.secondsSinceBatchPoint = 0;
+		powermanagement_data.batchStart = 0;
+		powermanagement_data.batchCount = 0;
+#endif
+		for (int i = 0; i < ULTRASONIC_CHANNEL_COUNT; i++)
+		{
+			powermanagement_data.lastMeasuredWaterLevel[i] = LAST_MEASURED_WATER_LEVEL_INVALID;
+			powermanagement_data.secondsSinceLevelFilterUpdate[i] = 0;
+			levelfilter_reset(&powermanagement_data.levelFilter[i]);
+#ifdef DERIVED_METRICS
+			powermanagement_data.secondsSinceMetricsUpdate[i] = 0;
+			metrics_reset(&powermanagement_data.metrics[i]);
+#endif
+		}
 		os_printf("\nDeactivating modem ...\n");
 		// save the data into RTC memory before we goto deep sleep
-		log_save();
-		system_rtc_mem_write(RTC_DATA_ADDRESS, &powermanagement_data, sizeof(powermanagement_data));
-		system_deep_sleep_set_option(4);
+		powermanagement_saveData();
+		system_deep_sleep_set_option(MEASUREMENT_DEEP_SLEEP_OPTION);
 		system_deep_sleep(DEEP_SLEEP_PERIOD_FOR_MODEM_ACTIVATION * 1000000);
 		return FALSE;
 	}
@@ -107,16 +194,107 @@ unsigned char ICACHE_FLASH_ATTR powermanagement_shouldPostLog()
 	return powermanagement_data.shouldPostLog;
 }
 
+#ifdef BATCH_POSTING
+// adds the water levels of all channels to the batch; if the batch is full the oldest measurement is overwritten
+// pWaterLevels: the water levels of all ultrasonic sensor channels in 1/DISTANCE_UNITS_PER_MM mm
+void ICACHE_FLASH_ATTR powermanagement_addBatchPoint(const sint32 *pWaterLevels)
+{
+	unsigned int seconds = powermanagement_getSecondsSinceBatchPoint();
+	BatchPoint *point;
+	if (powermanagement_data.batchCount < BATCH_MAX_POINTS)
+	{
+		point = &powermanagement_data.batch[(powermanagement_data.batchStart + powermanagement_data.batchCount) % BATCH_MAX_POINTS];
+		powermanagement_data.batchCount++;
+	}
+	else
+	{
+		point = &powermanagement_data.batch[powermanagement_data.batchStart];
+		powermanagement_data.batchStart = (powermanagement_data.batchStart + 1) % BATCH_MAX_POINTS;
+	}
+	point->secondsSincePrevious = seconds > 0xFFFF ? 0xFFFF : (unsigned short)seconds;
+	for (int i = 0; i < ULTRASONIC_CHANNEL_COUNT; i++)
+	{
+		sint32 waterLevel = pWaterLevels[i] / DISTANCE_UNITS_PER_MM;
+		point->waterLevel[i] = waterLevel < 0 ? 0 : (waterLevel > 0xFFFF ? 0xFFFF : (unsigned short)waterLevel);
+	}
+	powermanagement_data.secondsSinceBatchPoint = 0;
+	powermanagement_batchPointAwakeSeconds = system_get_time() / 1000000;
+}
+
+// gets the count of the measurements in the batch that are not posted yet
+unsigned char ICACHE_FLASH_ATTR powermanagement_getBatchPointCount()
+{
+	return powermanagement_data.batchCount;
+}
+
+// gets one measurement of the batch; index 0 is the oldest
+// pSecondsSincePrevious: seconds since the measurement before
+// pWaterLevel: the water level of the ultrasonic sensor channel in 1/DISTANCE_UNITS_PER_MM mm
+void ICACHE_FLASH_ATTR powermanagement_getBatchPoint(unsigned char pIndex, unsigned char pChannel, unsigned int *pSecondsSincePrevious, sint32 *pWaterLevel)
+{
+	BatchPoint *point = &powermanagement_data.batch[(powermanagement_data.batchStart + pIndex) % BATCH_MAX_POINTS];
+	*pSecondsSincePrevious = point->secondsSincePrevious;
+	*pWaterLevel = (sint32)point->waterLevel[pChannel] * DISTANCE_UNITS_PER_MM;
+}
+
+// gets the seconds since the newest measurement was added to the batch; including the awake time of this wake up
+unsigned int ICACHE_FLASH_ATTR powermanagement_getSecondsSinceBatchPoint()
+{
+	return powermanagement_data.secondsSinceBatchPoint + system_get_time() / 1000000 - powermanagement_batchPointAwakeSeconds;
+}
+
+// clears the batch after it is published; the time of the next measurement is relative to the last posted one
+void ICACHE_FLASH_ATTR powermanagement_batchPosted()
+{
+	powermanagement_data.batchStart = 0;
+	powermanagement_data.batchCount = 0;
+}
+#endif
+
 // checks the measurement
-// pCurrentWaterLevel: the measured water level in mm
-unsigned char ICACHE_FLASH_ATTR powermanagement_checkCurrentMeasurement(float pCurrentWaterLevel)
+// pCurrentWaterLevels: the measured water levels of all ultrasonic sensor channels in 1/DISTANCE_UNITS_PER_MM mm
+unsigned char ICACHE_FLASH_ATTR powermanagement_checkCurrentMeasurement(const sint32 *pCurrentWaterLevels)
 {
-	// is the last data too old or does the measured water level differs too much?
-	if (powermanagement_data.postUnchangedMeasurementCountDown == 0 ||
-		fabs(powermanagement_data.lastMeasuredWaterLevel - pCurrentWaterLevel) >= (double)configuration_getMinDifferenceToPost())
+	// is the last data too old?
+	unsigned char shouldPost = powermanagement_data.postUnchangedMeasurementCountDown == 0;
+	sint32 waterLevels[ULTRASONIC_CHANNEL_COUNT];
+	// or does the measured water level of one cistern differs too much?
+	for (int i = 0; i < ULTRASONIC_CHANNEL_COUNT; i++)
+	{
+		waterLevels[i] = pCurrentWaterLevels[i];
+		// a cycle without a valid shot delivers no water level; keep the last one if there is one
+		if (powermanagement_data.measurementQuality[i].validCount == 0)
+		{
+			// without a water level so far nothing is posted; the measured value of 0 would look like an empty cistern
+			if (powermanagement_data.lastMeasuredWaterLevel[i] == LAST_MEASURED_WATER_LEVEL_INVALID)
+			{
+				os_printf("No water level of channel %d; nothing to post\n", i);
+				return powermanagement_data.shouldPostMeasurement;
+			}
+			waterLevels[i] = powermanagement_data.lastMeasuredWaterLevel[i];
+		}
+		sint32 difference = powermanagement_data.lastMeasuredWaterLevel[i] - waterLevels[i];
+		if (difference < 0)
+		{
+			difference = -difference;
+		}
+		if (difference >= (sint32)configuration_getMinDifferenceToPost() * DISTANCE_UNITS_PER_MM)
+		{
+			shouldPost = TRUE;
+		}
+	}
+#ifdef BATCH_POSTING
+	// every measurement is kept; they are posted together if the batch is full, the data is too old or the water level differs too much
+	powermanagement_addBatchPoint(waterLevels);
+	if (powermanagement_data.batchCount >= BATCH_POST_POINTS)
+	{
+		shouldPost = TRUE;
+	}
+#endif
+	if (shouldPost == TRUE)
 	{
-		// then save the current measurement
-		powermanagement_data.lastMeasuredWaterLevel = pCurrentWaterLevel;
+		// then save the current measurement of all cisterns; they are posted together
+		os_memcpy(powermanagement_data.lastMeasuredWaterLevel, waterLevels, sizeof(powermanagement_data.lastMeasuredWaterLevel));
 		// measurement should be posted
 		powermanagement_data.shouldPostMeasurement = TRUE;
 		powermanagement_data.shouldDoMeasurement = FALSE;
@@ -124,12 +302,128 @@ unsigned char ICACHE_FLASH_ATTR powermanagement_checkCurrentMeasurement(float pC
 	return powermanagement_data.shouldPostMeasurement;
 }
 
-// gets the measured water level in mm; that value that was saved in RTC memory
-float ICACHE_FLASH_ATTR powermanagement_getLastMeasurement()
+// gets the seconds since the last update of the level filter of the channel; including the awake time of this wake up since the update
+static unsigned int ICACHE_FLASH_ATTR powermanagement_getSecondsSinceLevelFilterUpdate(unsigned char pChannel)
+{
+	return powermanagement_data.secondsSinceLevelFilterUpdate[pChannel] + system_get_time() / 1000000 - powermanagement_levelFilterAwakeSeconds[pChannel];
+}
+
+// updates the level filter of the ultrasonic sensor channel with the current measurement and returns the filtered water level
+// pChannel: the ultrasonic sensor channel
+// pCurrentWaterLevel: the measured water level in 1/DISTANCE_UNITS_PER_MM mm
+// pDispersion: the dispersion of the measured values in 1/DISTANCE_UNITS_PER_MM mm
+sint32 ICACHE_FLASH_ATTR powermanagement_filterMeasurement(unsigned char pChannel, sint32 pCurrentWaterLevel, sint32 pDispersion)
+{
+	unsigned int elapsedSeconds = powermanagement_getSecondsSinceLevelFilterUpdate(pChannel);
+	powermanagement_data.secondsSinceLevelFilterUpdate[pChannel] = 0;
+	powermanagement_levelFilterAwakeSeconds[pChannel] = system_get_time() / 1000000;
+	return levelfilter_update(&powermanagement_data.levelFilter[pChannel], pCurrentWaterLevel, pDispersion, elapsedSeconds);
+}
+
+// gets the rate of change of the filtered water level of the ultrasonic sensor channel in 1/DISTANCE_UNITS_PER_MM mm per hour
+sint32 ICACHE_FLASH_ATTR powermanagement_getLevelRate(unsigned char pChannel)
+{
+	return powermanagement_data.levelFilter[pChannel].rate;
+}
+
+#ifdef DERIVED_METRICS
+// gets the seconds since the last update of the metrics of the channel; including the awake time of this wake up since the update
+static unsigned int ICACHE_FLASH_ATTR powermanagement_getSecondsSinceMetricsUpdate(unsigned char pChannel)
+{
+	return powermanagement_data.secondsSinceMetricsUpdate[pChannel] + system_get_time() / 1000000 - powermanagement_metricsAwakeSeconds[pChannel];
+}
+
+// updates the derived metrics of the ultrasonic sensor channel with the current measurement
+// pWaterLevel: the water level in 1/DISTANCE_UNITS_PER_MM mm
+// pContent: the water content at this level in deciliters
+void ICACHE_FLASH_ATTR powermanagement_updateMetrics(unsigned char pChannel, sint32 pWaterLevel, sint32 pContent)
+{
+	unsigned int elapsedSeconds = powermanagement_getSecondsSinceMetricsUpdate(pChannel);
+	powermanagement_data.secondsSinceMetricsUpdate[pChannel] = 0;
+	powermanagement_metricsAwakeSeconds[pChannel] = system_get_time() / 1000000;
+	metrics_update(&powermanagement_data.metrics[pChannel], pWaterLevel, pContent, elapsedSeconds);
+}
+
+// gets the flow rate of the cistern of the ultrasonic sensor channel in deciliters per hour; positive = inflow; negative = outflow
+sint32 ICACHE_FLASH_ATTR powermanagement_getFlowRate(unsigned char pChannel)
 {
-	return powermanagement_data.lastMeasuredWaterLevel;
+	return metrics_getRate(&powermanagement_data.metrics[pChannel]);
 }
 
+// gets the consumption of the cistern of the ultrasonic sensor channel in the last METRICS_HOURS hours in deciliters
+uint32 ICACHE_FLASH_ATTR powermanagement_getConsumption(unsigned char pChannel)
+{
+	return metrics_getConsumption(&powermanagement_data.metrics[pChannel]);
+}
+
+// gets the projected time in minutes until the cistern of the ultrasonic sensor channel is empty; METRICS_NOT_EMPTYING if there is no outflow
+sint32 ICACHE_FLASH_ATTR powermanagement_getTimeToEmpty(unsigned char pChannel)
+{
+	return metrics_getTimeToEmpty(&powermanagement_data.metrics[pChannel]);
+}
+#endif
+
+// delivers TRUE if the level filters of all channels are settled and a measurement with only a few shots is sufficient
+unsigned char ICACHE_FLASH_ATTR powermanagement_isLevelFilterSettled()
+{
+	for (int i = 0; i < ULTRASONIC_CHANNEL_COUNT; i++)
+	{
+		if (levelfilter_isSettled(&powermanagement_data.levelFilter[i]) == FALSE)
+		{
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+// stores the quality of the last measurement cycle of the ultrasonic sensor channel into RTC memory
+void ICACHE_FLASH_ATTR powermanagement_setMeasurementQuality(unsigned char pChannel, const MeasurementQuality *pQuality)
+{
+	powermanagement_data.measurementQuality[pChannel] = *pQuality;
+}
+
+// gets the quality of the last measurement cycle of the ultrasonic sensor channel; that value that was saved in RTC memory
+const MeasurementQuality* ICACHE_FLASH_ATTR powermanagement_getMeasurementQuality(unsigned char pChannel)
+{
+	return &powermanagement_data.measurementQuality[pChannel];
+}
+
+// delivers TRUE if the signal of the last measurement cycle of all channels was clean:
+// no lost shot, no shot out of range and the jitter not greater than CLEAN_SIGNAL_MAX_JITTER_MM
+unsigned char ICACHE_FLASH_ATTR powermanagement_isSignalClean()
+{
+	for (int i = 0; i < ULTRASONIC_CHANNEL_COUNT; i++)
+	{
+		const MeasurementQuality *quality = &powermanagement_data.measurementQuality[i];
+		if (quality->validCount == 0 || quality->lostCount > 0 || quality->outOfRangeCount > 0 ||
+			quality->jitter > CLEAN_SIGNAL_MAX_JITTER_MM * DISTANCE_UNITS_PER_MM)
+		{
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+// gets the measured water level of the ultrasonic sensor channel in 1/DISTANCE_UNITS_PER_MM mm; that value that was saved in RTC memory
+sint32 ICACHE_FLASH_ATTR powermanagement_getLastMeasurement(unsigned char pChannel)
+{
+	return powermanagement_data.lastMeasuredWaterLevel[pChannel];
+}
+
+// replaces the saved water level of the ultrasonic sensor channel in 1/DISTANCE_UNITS_PER_MM mm with a fresh measurement
+void ICACHE_FLASH_ATTR powermanagement_setLastMeasurement(unsigned char pChannel, sint32 pWaterLevel)
+{
+	powermanagement_data.lastMeasuredWaterLevel[pChannel] = pWaterLevel;
+}
+
+#ifdef WIFI_FAST_CONNECT
+// gets the parameters of the last connection to the access point; that values that were saved in RTC memory
+WifiConnectionCache* ICACHE_FLASH_ATTR powermanagement_getWifiConnectionCache()
+{
+	return &powermanagement_data.wifiConnectionCache;
+}
+#endif
+
 // set the flags to signal that the measurement is posted successfully to the internet
 void ICACHE_FLASH_ATTR powermanagement_measurementPosted()
 {
@@ -153,8 +447,8 @@ void ICACHE_FLASH_ATTR powermanagement_deepSleep()
 {
 	// set the wakeup option and goto deep sleep mode
 	unsigned int deepSleepPeriod = configuration_getDeepSleepPeriod() * 1000000;
-	// wake up without modem
-	unsigned char deepSleepOption = 4;
+	// wake up for the next measurement
+	unsigned char deepSleepOption = MEASUREMENT_DEEP_SLEEP_OPTION;
 	if (powermanagement_data.shouldPostMeasurement == TRUE)
 	{
 		deepSleepPeriod = DEEP_SLEEP_PERIOD_FOR_MODEM_ACTIVATION * 1000000;
@@ -179,14 +473,33 @@ void ICACHE_FLASH_ATTR powermanagement_deepSleep()
 		os_printf("\nSleeping for %d seconds ...\n", configuration_getDeepSleepPeriod());
 	}
 	os_printf("Deep sleep option: %d\n", deepSleepOption);
+	// count the time until the next measurement for the level filter
+	for (int i = 0; i < ULTRASONIC_CHANNEL_COUNT; i++)
+	{
+		powermanagement_data.secondsSinceLevelFilterUpdate[i] = powermanagement_getSecondsSinceLevelFilterUpdate(i) + deepSleepPeriod / 1000000;
+#ifdef DERIVED_METRICS
+		powermanagement_data.secondsSinceMetricsUpdate[i] = powermanagement_getSecondsSinceMetricsUpdate(i) + deepSleepPeriod / 1000000;
+#endif
+	}
+#ifdef BATCH_POSTING
+	powermanagement_data.secondsSinceBatchPoint = powermanagement_getSecondsSinceBatchPoint() + deepSleepPeriod / 1000000;
+#endif
 	// save the data into RTC memory before we goto deep sleep
-	log_save();
-	system_rtc_mem_write(RTC_DATA_ADDRESS, &powermanagement_data, sizeof(powermanagement_data));
+	powermanagement_saveData();
 	// set wake-up option and start deep sleep
 	system_deep_sleep_set_option(deepSleepOption);
 	system_deep_sleep(deepSleepPeriod);
 }
 
+// the continuous mode needs the modem; it's only active after a wake up for posting
+// so the module goes to one deep sleep cycle for activating the modem
+void ICACHE_FLASH_ATTR powermanagement_activateModem()
+{
+	powermanagement_data.shouldPostMeasurement = TRUE;
+	powermanagement_data.shouldDoMeasurement = FALSE;
+	powermanagement_deepSleep();
+}
+
 // preparation for entering the configuration mode
 void ICACHE_FLASH_ATTR powermanagement_enterConfigurationMode()
 {
@@ -202,11 +515,24 @@ void ICACHE_FLASH_ATTR powermanagement_leaveConfigurationMode()
 	powermanagement_data.shoudlEnterConfigurationMode = FALSE;
 	powermanagement_data.shouldPostMeasurement = FALSE;
 	powermanagement_data.shouldDoMeasurement = TRUE;
+	// the configuration may have changed; start the level filter and the metrics from scratch
+	for (int i = 0; i < ULTRASONIC_CHANNEL_COUNT; i++)
+	{
+		powermanagement_data.secondsSinceLevelFilterUpdate[i] = 0;
+		levelfilter_reset(&powermanagement_data.levelFilter[i]);
+#ifdef DERIVED_METRICS
+		powermanagement_data.secondsSinceMetricsUpdate[i] = 0;
+		metrics_reset(&powermanagement_data.metrics[i]);
+#endif
+	}
+#ifdef WIFI_FAST_CONNECT
+	// the access point may have changed
+	powermanagement_data.wifiConnectionCache.channel = 0;
+#endif
 	os_printf("\nDeactivating modem ...\n");
 	// save the data into RTC memory before we goto deep sleep
-	log_save();
-	system_rtc_mem_write(RTC_DATA_ADDRESS, &powermanagement_data, sizeof(powermanagement_data));
-	system_deep_sleep_set_option(4);
+	powermanagement_saveData();
+	system_deep_sleep_set_option(MEASUREMENT_DEEP_SLEEP_OPTION);
 	system_deep_sleep(DEEP_SLEEP_PERIOD_FOR_MODEM_ACTIVATION * 1000000);
 }
 
@@ -220,6 +546,16 @@ void ICACHE_FLASH_ATTR powermanagement_setNextLogBytePointer(unsigned int nextLo
 	powermanagement_data.nextLogBytePointer = nextLogBytePointer;
 }
 
+// the tuned settle time of the ultrasonic sensors after switching them on in milliseconds; 0 = not tuned yet; see SENSOR_POWER_GATING
+unsigned short ICACHE_FLASH_ATTR powermanagement_getSensorSettleTime()
+{
+	return powermanagement_data.sensorSettleTime;
+}
+void ICACHE_FLASH_ATTR powermanagement_setSensorSettleTime(unsigned short sensorSettleTime)
+{
+	powermanagement_data.sensorSettleTime = sensorSettleTime;
+}
+
 // call this to signal that the program should post the log data to the internet; and don't do a water level measurement
 void ICACHE_FLASH_ATTR powermanagement_setShouldPostLog(unsigned char shouldPostLog)
 {
@@ -16,9 +16,13 @@
 #include <uart_hw.h>
 #include <log.h>
 
+// if FALSE the output is only logged; UART0 is used by a sensor
+static unsigned char stdout_isUartEnabled = TRUE;
+
 static void ICACHE_FLASH_ATTR stdout_uartTxd(char c) {
 	// log the char
 	log_write(c);
+	if (!stdout_isUartEnabled) return;
 	//Wait until there is room in the FIFO
 	while (((READ_PERI_REG(UART_STATUS(0))>>UART_TXFIFO_CNT_S)&UART_TXFIFO_CNT)>=126) ;
 	//Send the character
@@ -51,3 +55,8 @@ void ICACHE_FLASH_ATTR stdout_init() {
 	//Install our own putchar handler
 	os_install_putc1((void *)stdout_putchar);
 }
+
+// enables or disables the output to UART0; the log gets the output anyway
+void ICACHE_FLASH_ATTR stdout_setUartEnabled(unsigned char isEnabled) {
+	stdout_isUartEnabled = isEnabled;
+}
@@ -0,0 +1,272 @@
+/*
+* ----------------------------------------------------------------------------
+* The MIT License (MIT)
+*
+* Copyright (c) 2016 - Matthias Jentsch
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+* ----------------------------------------------------------------------------
+*/
+
+#include "user_interface.h"
+#include "osapi.h"
+#include "mem.h"
+#include <espmissingincludes.h>
+#include <ultrasonicmeter.h>
+#include <strappingtable.h>
+
+// magic number at the beginning of the strapping tables ("ST")
+#define STRAPPING_TABLE_MAGIC 0x5453
+// version of the table layout; change it if the layout of StrappingTable changes
+#define STRAPPING_TABLE_VERSION 1
+
+// header of the strapping tables
+typedef struct
+{
+	uint16 magic;	// STRAPPING_TABLE_MAGIC; otherwise the tables are not valid
+	uint8 version;	// STRAPPING_TABLE_VERSION
+	uint8 channelCount;	// count of ultrasonic sensor channels
+	uint16 pointCount[2];	// count of points per channel; always two entries to keep the tables aligned to 4-byte boundaries
+} StrappingTableHeader;
+
+// the strapping tables as they are stored in flash (3KB max)
+typedef struct
+{
+	StrappingTableHeader header;
+	uint16 levels[ULTRASONIC_CHANNEL_COUNT][STRAPPING_TABLE_MAX_POINTS];	// water level of the point in millimeters; rising
+	uint32 milliliters[ULTRASONIC_CHANNEL_COUNT][STRAPPING_TABLE_MAX_POINTS];	// water content at the level of the point in milliliters; not falling
+} StrappingTable;
+
+// the header read from flash; only read once per wake up
+static StrappingTableHeader strappingtable_header;
+// TRUE if strappingtable_header is read from flash
+static unsigned char strappingtable_isHeaderLoaded = FALSE;
+// the tables received in the configuration mode; NULL until the first point is set
+static StrappingTable *strappingtable_received = NULL;
+
+// reads the header from flash if not already done; returns TRUE if the saved tables are valid
+static unsigned char ICACHE_FLASH_ATTR strappingtable_loadHeader()
+{
+	if (strappingtable_isHeaderLoaded == FALSE)
+	{
+		spi_flash_read(STRAPPING_TABLE_START_SEC * SPI_FLASH_SEC_SIZE, (uint32*)&strappingtable_header, sizeof(StrappingTableHeader));
+		strappingtable_isHeaderLoaded = TRUE;
+	}
+	return strappingtable_header.magic == STRAPPING_TABLE_MAGIC && strappingtable_header.version == STRAPPING_TABLE_VERSION &&
+		strappingtable_header.channelCount == ULTRASONIC_CHANNEL_COUNT;
+}
+
+// reads the level of one point from flash; the flash can only be read in aligned 4-byte words with two levels each
+static unsigned short ICACHE_FLASH_ATTR strappingtable_readLevel(unsigned char pChannel, unsigned short pIndex)
+{
+	uint32 address = STRAPPING_TABLE_START_SEC * SPI_FLASH_SEC_SIZE + sizeof(StrappingTableHeader) +
+		(pChannel * STRAPPING_TABLE_MAX_POINTS + pIndex) * sizeof(uint16);
+	uint32 word;
+	spi_flash_read(address & ~3, &word, sizeof(word));
+	return (address & 2) ? (unsigned short)(word >> 16) : (unsigned short)(word & 0xFFFF);
+}
+
+// reads the content of one point from flash
+static uint32 ICACHE_FLASH_ATTR strappingtable_readMilliliters(unsigned char pChannel, unsigned short pIndex)
+{
+	uint32 milliliters;
+	spi_flash_read(STRAPPING_TABLE_START_SEC * SPI_FLASH_SEC_SIZE + sizeof(StrappingTableHeader) + sizeof(((StrappingTable*)0)->levels) +
+		(pChannel * STRAPPING_TABLE_MAX_POINTS + pIndex) * sizeof(uint32), &milliliters, sizeof(milliliters));
+	return milliliters;
+}
+
+// sets one point of the received strapping table of the cistern of the channel; the index 0 starts a new table
+unsigned char ICACHE_FLASH_ATTR strappingtable_setPoint(unsigned char pChannel, unsigned short pIndex, unsigned short pLevel, uint32 pMilliliters)
+{
+	if (pChannel >= ULTRASONIC_CHANNEL_COUNT || pIndex >= STRAPPING_TABLE_MAX_POINTS)
+	{
+		return FALSE;
+	}
+	if (strappingtable_received == NULL)
+	{
+		// start with the saved tables; so the tables of the other channels are kept
+		strappingtable_received = (StrappingTable*)os_malloc(sizeof(StrappingTable));
+		if (strappingtable_received == NULL)
+		{
+			return FALSE;
+		}
+		if (strappingtable_loadHeader() == TRUE)
+		{
+			spi_flash_read(STRAPPING_TABLE_START_SEC * SPI_FLASH_SEC_SIZE, (uint32*)strappingtable_received, sizeof(StrappingTable));
+		}
+		else
+		{
+			os_memset(strappingtable_received, 0, sizeof(StrappingTable));
+			strappingtable_received->header.magic = STRAPPING_TABLE_MAGIC;
+			strappingtable_received->header.version = STRAPPING_TABLE_VERSION;
+			strappingtable_received->header.channelCount = ULTRASONIC_CHANNEL_COUNT;
+		}
+	}
+	if (pIndex == 0)
+	{
+		strappingtable_received->header.pointCount[pChannel] = 0;
+	}
+	// the points must be set in order; the binary search needs rising levels and the interpolation not falling contents
+	if (pIndex != strappingtable_received->header.pointCount[pChannel] ||
+		(pIndex > 0 && (pLevel <= strappingtable_received->levels[pChannel][pIndex - 1] ||
+			pMilliliters < strappingtable_received->milliliters[pChannel][pIndex - 1])))
+	{
+		return FALSE;
+	}
+	strappingtable_received->levels[pChannel][pIndex] = pLevel;
+	strappingtable_received->milliliters[pChannel][pIndex] = pMilliliters;
+	strappingtable_received->header.pointCount[pChannel]++;
+	return TRUE;
+}
+
+// returns TRUE if the received tables are the same as the saved ones; compares in chunks so that no second table is allocated
+static unsigned char ICACHE_FLASH_ATTR strappingtable_isReceivedSaved()
+{
+	uint32 chunk[16];
+
+	for (uint32 offset = 0; offset < sizeof(StrappingTable); offset += sizeof(chunk))
+	{
+		uint32 size = sizeof(StrappingTable) - offset < sizeof(chunk) ? sizeof(StrappingTable) - offset : sizeof(chunk);
+		spi_flash_read(STRAPPING_TABLE_START_SEC * SPI_FLASH_SEC_SIZE + offset, chunk, size);
+		if (os_memcmp(chunk, (uint8*)strappingtable_received + offset, size) != 0)
+		{
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+// returns TRUE if a strapping table was received in the configuration mode
+unsigned char ICACHE_FLASH_ATTR strappingtable_isReceived()
+{
+	return strappingtable_received != NULL;
+}
+
+// saves the received strapping tables into flash; the saved tables of the other channels are kept
+// the sector is only erased if the received tables differ from the saved ones
+void ICACHE_FLASH_ATTR strappingtable_save()
+{
+	if (strappingtable_received == NULL)
+	{
+		return;
+	}
+	if (strappingtable_isReceivedSaved() == FALSE)
+	{
+		// the tables fit into one sector
+		spi_flash_erase_sector(STRAPPING_TABLE_START_SEC);
+		spi_flash_write(STRAPPING_TABLE_START_SEC * SPI_FLASH_SEC_SIZE, (uint32*)strappingtable_received, sizeof(StrappingTable));
+		os_printf("Strapping table saved\n");
+	}
+	strappingtable_header = strappingtable_received->header;
+	strappingtable_isHeaderLoaded = TRUE;
+	os_free(strappingtable_received);
+	strappingtable_received = NULL;
+}
+
+// gets the count of points of the strapping table of the cistern of the channel; the received table if there is one, otherwise the saved one
+unsigned short ICACHE_FLASH_ATTR strappingtable_getPointCount(unsigned char pChannel)
+{
+	if (pChannel >= ULTRASONIC_CHANNEL_COUNT)
+	{
+		return 0;
+	}
+	if (strappingtable_received != NULL)
+	{
+		return strappingtable_received->header.pointCount[pChannel];
+	}
+	return strappingtable_loadHeader() == TRUE ? strappingtable_header.pointCount[pChannel] : 0;
+}
+
+// gets one point of the strapping table of the cistern of the channel; the received table if there is one, otherwise the saved one
+unsigned char ICACHE_FLASH_ATTR strappingtable_getPoint(unsigned char pChannel, unsigned short pIndex, unsigned short *pLevel, uint32 *pMilliliters)
+{
+	if (pIndex >= strappingtable_getPointCount(pChannel))
+	{
+		return FALSE;
+	}
+	if (strappingtable_received != NULL)
+	{
+		*pLevel = strappingtable_received->levels[pChannel][pIndex];
+		*pMilliliters = strappingtable_received->milliliters[pChannel][pIndex];
+	}
+	else
+	{
+		*pLevel = strappingtable_readLevel(pChannel, pIndex);
+		*pMilliliters = strappingtable_readMilliliters(pChannel, pIndex);
+	}
+	return TRUE;
+}
+
+// gets the water content of the cistern of the channel in milliliters by binary search and linear interpolation of the saved table
+unsigned char ICACHE_FLASH_ATTR strappingtable_getMilliliters(unsigned char pChannel, sint32 pWaterLevel, uint32 *pMilliliters)
+{
+	if (pChannel >= ULTRASONIC_CHANNEL_COUNT || strappingtable_loadHeader() == FALSE || strappingtable_header.pointCount[pChannel] < 2)
+	{
+		return FALSE;
+	}
+	unsigned short last = strappingtable_header.pointCount[pChannel] - 1;
+
+	// below the first point and above the last point the content is constant
+	if (pWaterLevel <= (sint32)strappingtable_readLevel(pChannel, 0) * DISTANCE_UNITS_PER_MM)
+	{
+		*pMilliliters = strappingtable_readMilliliters(pChannel, 0);
+		return TRUE;
+	}
+	sint32 highLevel = (sint32)strappingtable_readLevel(pChannel, last) * DISTANCE_UNITS_PER_MM;
+	if (pWaterLevel >= highLevel)
+	{
+		*pMilliliters = strappingtable_readMilliliters(pChannel, last);
+		return TRUE;
+	}
+
+	// binary search for the segment with level[low] < pWaterLevel < level[high]; one flash read per step
+	unsigned short low = 0;
+	unsigned short high = last;
+	while (high - low > 1)
+	{
+		unsigned short middle = (low + high) / 2;
+		sint32 middleLevel = (sint32)strappingtable_readLevel(pChannel, middle) * DISTANCE_UNITS_PER_MM;
+		if (middleLevel <= pWaterLevel)
+		{
+			low = middle;
+		}
+		else
+		{
+			high = middle;
+			highLevel = middleLevel;
+		}
+	}
+	sint32 lowLevel = (sint32)strappingtable_readLevel(pChannel, low) * DISTANCE_UNITS_PER_MM;
+	uint32 lowMilliliters = strappingtable_readMilliliters(pChannel, low);
+	uint32 highMilliliters = strappingtable_readMilliliters(pChannel, high);
+	// the fraction of the segment with 16 bits; the span is reduced below 2^16 so that the shifted offset fits into 32 bits
+	uint32 offset = (uint32)(pWaterLevel - lowLevel);
+	uint32 span = (uint32)(highLevel - lowLevel);
+	while (span > 0xFFFF)
+	{
+		offset >>= 1;
+		span >>= 1;
+	}
+	uint32 fraction = (offset << 16) / span;
+	// the difference is split into 16-bit halves so that no product overflows 32 bits instead of the soft 64-bit division
+	// the content doesn't fall with the level; so the difference is never negative
+	uint32 difference = highMilliliters - lowMilliliters;
+	*pMilliliters = lowMilliliters + (difference >> 16) * fraction + (((difference & 0xFFFF) * fraction) >> 16);
+	return TRUE;
+}
\ No newline at end of file
@@ -0,0 +1,102 @@
+/*
+* ----------------------------------------------------------------------------
+* The MIT License (MIT)
+*
+* Copyright (c) 2016 - Matthias Jentsch
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+* ----------------------------------------------------------------------------
+*/
+
+#include "user_interface.h"
+#include "osapi.h"
+#include <espmissingincludes.h>
+#include <estimator.h>
+#include <trace.h>
+
+#ifdef ULTRASONIC_TRACE
+
+// the trace of the current measurement cycle
+static Trace trace_data;
+// TRUE while the events of a measurement cycle are recorded
+static unsigned char trace_isRecording = FALSE;
+
+// starts recording the trace of a new measurement cycle
+void ICACHE_FLASH_ATTR trace_start(uint8 channelCount, uint32 ticksPerUs)
+{
+	os_memset(&trace_data, 0, sizeof(trace_data));
+	trace_data.header.magic = TRACE_MAGIC;
+	trace_data.header.version = TRACE_VERSION;
+	trace_data.header.channelCount = channelCount;
+	trace_data.header.estimator = ULTRASONIC_ESTIMATOR;
+	trace_data.header.ticksPerUs = ticksPerUs;
+	trace_isRecording = TRUE;
+}
+
+// sets the distance in millimeters water to ultrasonic sensor of the channel if the cistern is empty
+void ICACHE_FLASH_ATTR trace_setDistanceEmpty(uint8 channel, uint32 distanceEmpty)
+{
+	if (channel < TRACE_MAX_CHANNELS)
+	{
+		trace_data.header.distanceEmpty[channel] = distanceEmpty;
+	}
+}
+
+// records one event of the current measurement cycle
+void ICACHE_FLASH_ATTR trace_record(uint8 type, uint8 channel, uint32 timestamp)
+{
+	// not recording or trace full?
+	if (trace_isRecording == FALSE || trace_data.header.recordCount >= TRACE_MAX_RECORDS)
+	{
+		return;
+	}
+	TraceRecord *record = &trace_data.records[trace_data.header.recordCount];
+	record->type = type;
+	record->channel = channel;
+	record->timestamp = timestamp;
+	trace_data.header.recordCount++;
+}
+
+// stops recording and saves the trace of the current measurement cycle into flash
+void ICACHE_FLASH_ATTR trace_save()
+{
+	if (trace_isRecording == FALSE)
+	{
+		return;
+	}
+	trace_isRecording = FALSE;
+	// the trace fits into one sector; only the last trace is kept
+	spi_flash_erase_sector(TRACE_DATA_START_SEC);
+	spi_flash_write(TRACE_DATA_START_SEC * SPI_FLASH_SEC_SIZE, (uint32*)&trace_data, sizeof(trace_data));
+	os_printf("Trace saved: %d records\n", trace_data.header.recordCount);
+}
+
+// reads the last saved trace from flash; returns the size of the trace in bytes or 0 if no valid trace was found
+unsigned short ICACHE_FLASH_ATTR trace_load(Trace *pTrace)
+{
+	spi_flash_read(TRACE_DATA_START_SEC * SPI_FLASH_SEC_SIZE, (uint32*)pTrace, sizeof(Trace));
+	if (pTrace->header.magic != TRACE_MAGIC || pTrace->header.version != TRACE_VERSION ||
+		pTrace->header.recordCount > TRACE_MAX_RECORDS)
+	{
+		return 0;
+	}
+	return sizeof(TraceHeader) + pTrace->header.recordCount * sizeof(TraceRecord);
+}
+
+#endif // ULTRASONIC_TRACE
\ No newline at end of file
@@ -0,0 +1,145 @@
+/*
+* ----------------------------------------------------------------------------
+* The MIT License (MIT)
+*
+* Copyright (c) 2016 - Matthias Jentsch
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+* ----------------------------------------------------------------------------
+*/
+
+#include "user_interface.h"
+#include "osapi.h"
+#include "gpio.h"
+#include <espmissingincludes.h>
+#include <uart_hw.h>
+#include <stdout.h>
+#include <io.h>
+#include <sensor.h>
+#include <uartsensor.h>
+
+#if ULTRASONIC_SENSOR == SENSOR_UART
+
+// baud rate of the sensor
+#define UART_SENSOR_BIT_RATE BIT_RATE_9600
+// baud rate of the debug output; see stdout.c
+#define UART_DEBUG_BIT_RATE BIT_RATE_74880
+// one frame: header, distance high byte, distance low byte, checksum (low byte of the sum of the other bytes)
+#define UART_SENSOR_FRAME_SIZE 4
+#define UART_SENSOR_FRAME_HEADER 0xFF
+// the RX FIFO is polled with this period in milliseconds; it holds 128 bytes so that's far below the limit for 9600 baud
+#define UART_SENSOR_POLL_PERIOD_MS 10
+// the sensor sends a frame every 100 to 300 ms; if there is no valid frame within this timespan in milliseconds the frame is lost
+#define UART_SENSOR_FRAME_TIMEOUT_MS 500
+
+// the timer for polling the RX FIFO
+static ETSTimer uartSensor_pollTimer;
+// called for every received frame; NULL if the sensor isn't read
+static uartSensor_frameCallback *uartSensor_callback = NULL;
+// the bytes of the current frame
+static unsigned char uartSensor_frame[UART_SENSOR_FRAME_SIZE];
+// count of the received bytes of the current frame
+static unsigned char uartSensor_frameIndex = 0;
+// milliseconds since the last valid frame
+static unsigned int uartSensor_msSinceLastFrame = 0;
+
+// waits until the debug output has left the TX FIFO
+static void ICACHE_FLASH_ATTR uartSensor_flushTx()
+{
+	while (((READ_PERI_REG(UART_STATUS(0)) >> UART_TXFIFO_CNT_S) & UART_TXFIFO_CNT) > 0)
+	{
+	}
+}
+
+// timer function; reads the received bytes and calls the callback for every valid frame or if the frame timeout is elapsed
+static void ICACHE_FLASH_ATTR uartSensor_poll(void *arg)
+{
+	while (((READ_PERI_REG(UART_STATUS(0)) >> UART_RXFIFO_CNT_S) & UART_RXFIFO_CNT) > 0)
+	{
+		unsigned char data = READ_PERI_REG(UART_FIFO(0)) & 0xFF;
+		// wait for the start of a frame
+		if (uartSensor_frameIndex == 0 && data != UART_SENSOR_FRAME_HEADER)
+		{
+			continue;
+		}
+		uartSensor_frame[uartSensor_frameIndex++] = data;
+		if (uartSensor_frameIndex < UART_SENSOR_FRAME_SIZE)
+		{
+			continue;
+		}
+		uartSensor_frameIndex = 0;
+		// skip frames with a wrong checksum
+		if (((uartSensor_frame[0] + uartSensor_frame[1] + uartSensor_frame[2]) & 0xFF) != uartSensor_frame[3])
+		{
+			continue;
+		}
+		uartSensor_msSinceLastFrame = 0;
+		uartSensor_callback(((sint32)uartSensor_frame[1] << 8) | uartSensor_frame[2]);
+		// stopped by the callback?
+		if (uartSensor_callback == NULL)
+		{
+			return;
+		}
+	}
+	uartSensor_msSinceLastFrame += UART_SENSOR_POLL_PERIOD_MS;
+	if (uartSensor_msSinceLastFrame >= UART_SENSOR_FRAME_TIMEOUT_MS)
+	{
+		uartSensor_msSinceLastFrame = 0;
+		uartSensor_callback(-1);
+	}
+}
+
+// starts reading the frames of the sensor
+void ICACHE_FLASH_ATTR uartSensor_start(uartSensor_frameCallback *pCallback)
+{
+	uartSensor_callback = pCallback;
+	uartSensor_frameIndex = 0;
+	uartSensor_msSinceLastFrame = 0;
+
+	// the debug output would go to GPIO15 (the RX pin of the sensor) while the UART is swapped
+	// so let the pending output leave first and suppress the output until the UART is swapped back
+	uartSensor_flushTx();
+	stdout_setUartEnabled(FALSE);
+	system_uart_swap();
+	uart_div_modify(0, UART_CLK_FREQ / UART_SENSOR_BIT_RATE);
+	// throw away everything that was received before
+	SET_PERI_REG_MASK(UART_CONF0(0), UART_RXFIFO_RST);
+	CLEAR_PERI_REG_MASK(UART_CONF0(0), UART_RXFIFO_RST);
+	// RX pin of the sensor high: send the filtered distance
+	gpio_output_set((1 << TRIGGER_GPIO), 0, (1 << TRIGGER_GPIO), 0);
+
+	os_timer_disarm(&uartSensor_pollTimer);
+	os_timer_setfn(&uartSensor_pollTimer, uartSensor_poll, NULL);
+	os_timer_arm(&uartSensor_pollTimer, UART_SENSOR_POLL_PERIOD_MS, 1);
+}
+
+// stops reading the frames and gives UART0 back to the debug output
+void ICACHE_FLASH_ATTR uartSensor_stop()
+{
+	os_timer_disarm(&uartSensor_pollTimer);
+	uartSensor_callback = NULL;
+	gpio_output_set(0, (1 << TRIGGER_GPIO), (1 << TRIGGER_GPIO), 0);
+
+	uartSensor_flushTx();
+	uart_div_modify(0, UART_CLK_FREQ / UART_DEBUG_BIT_RATE);
+	system_uart_de_swap();
+	stdout_setUartEnabled(TRUE);
+}
+
+#endif
\ No newline at end of file
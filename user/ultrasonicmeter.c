@@ -30,7 +30,23 @@
 #include <espmissingincludes.h>
 #include <io.h>
 #include <configuration.h>
+#include <estimator.h>
+#include <trace.h>
+#include <hwtimer.h>
+#include <sensor.h>
+#include <uartsensor.h>
 #include <ultrasonicmeter.h>
+#include <powermanagement.h>
+
+#if ULTRASONIC_CHANNEL_COUNT < 1 || ULTRASONIC_CHANNEL_COUNT > 2
+#error "ULTRASONIC_CHANNEL_COUNT must be 1 or 2"
+#endif
+#if ULTRASONIC_SENSOR == SENSOR_UART && ULTRASONIC_CHANNEL_COUNT > 1
+#error "SENSOR_UART supports only one channel"
+#endif
+#if !SENSOR_HAS_ECHO_PULSE && defined(ULTRASONIC_TRACE)
+#error "ULTRASONIC_TRACE records the echo edges; not available for SENSOR_UART"
+#endif
 
 // modes for the state machine
 // initial state
@@ -43,224 +59,796 @@
 #define WAITFOR_SILENCE 3
 // we are done; measurement is finished
 #define FINISHED 4
+// the next shot is scheduled; waiting for the hardware timer to start the trigger pulse
+#define WAITFOR_TRIGGER_START 5
+// the trigger pulse is running; waiting for the hardware timer to end it
+#define WAITFOR_TRIGGER_END 6
+
+// additional edge types of the recorded echo edges
+// no echo was received within the echo timeout
+#define NO_ECHO 7
+// the trigger pulse was started; only recorded for the trace
+#define TRIGGER_STARTED 8
 
-// Duration for waiting for "silence" (ultrasonic silence) in milliseconds, that's the timespan between two single shot measurements
-#define SILENCE_TIMESPAN_MS 1500
+#if SENSOR_HAS_ECHO_PULSE
+// the echo of a shot must be received within the round trip time for the empty cistern (see distanceEmpty) plus this margin in µs;
+// the sensor starts the echo pulse about 0.5 ms after the trigger pulse
+#define ECHO_TIMEOUT_MARGIN_US 2000
+// after an echo was received we wait this multiple of the worst case round trip time (see distanceEmpty) for the reverberation to decay;
+// but at least SENSOR_MIN_SILENCE_TIMESPAN_MS
+#define SILENCE_ROUND_TRIPS 3
 
-// Unit of measurement according to the datashett of HC-SR04 (58 s / cm = 5,8 s / mm)
-#define US_PER_MM 5.8
+// Unit of measurement according to the datashett of HC-SR04 (58 µs / cm = 5,8 µs / mm); the same for the JSN-SR04T
+#define US_PER_CM 58
 
-// Length of the trigger pulse in s
-#define TRIGGER_PULSE_US 15
+// size of the ring buffer for the echo edges; must be a power of two
+#define ECHO_EVENTS_SIZE 8
+
+// priority of the system task that processes the echo edges (MQTT uses priority 2)
+#define ULTRASONIC_TASK_PRIO 1
+// queue size of the system task that processes the echo edges
+#define ULTRASONIC_TASK_QUEUE_SIZE 4
+#endif
 
 // how often should the module do a measurement?
 #define MAX_MEASUREMENTS 10
+// values of measuredDistances for invalid shots
+// the echo is farther away than distanceEmpty or in the blind zone of the sensor
+#define DISTANCE_OUT_OF_RANGE (-1)
+// the shot is lost; no echo was received
+#define DISTANCE_LOST (-2)
+#if ULTRASONIC_SENSOR == SENSOR_UART
+// the UART sensor filters the distance itself; so the measurement cycle is finished with this count of valid frames
+#define UART_SENSOR_VALID_FRAMES 1
+#endif
+
+#ifdef SENSOR_POWER_GATING
+// settle time of the sensors after switching them on in milliseconds if it isn't tuned yet
+#define SENSOR_SETTLE_INITIAL_MS 200
+// limits of the tuned settle time in milliseconds
+#define SENSOR_SETTLE_MIN_MS 10
+#define SENSOR_SETTLE_MAX_MS 1000
+// if the first shots of all channels are valid the settle time is decreased by this step in milliseconds to find the shortest settle time;
+// if the first shot of a channel is invalid but a later shot is valid the settle time was too short and is increased by the half
+#define SENSOR_SETTLE_DECREASE_MS 5
+#endif
 
-// Echo quality 0 = no echo received; MAX_MEASUREMENTS = best possible; all MAX_MEASUREMENTS measurements are received
-static unsigned char ultrasonicMeter_valueQuality = 5;
-// all the measured values
-static float ultrasonicMeter_measuredDistances[MAX_MEASUREMENTS];
-// the index in the ultrasonicMeter_MeasuredDistances array
-static unsigned char ultrasonicMeter_measuredDistancesIndex = 0;
-// current state
-static unsigned char ultrasonicMeter_currentState = WAITFOR_NOTHING;
+#if SENSOR_HAS_ECHO_PULSE
+// one echo edge recorded by the interrupt handler
+typedef struct
+{
+	unsigned char edge;	// the edge type; WAITFOR_ECHO_POSITIVE_EDGE or WAITFOR_ECHO_NEGATIVE_EDGE
+	unsigned char channel;	// the sensor channel that has fired the shot
+	uint32 timestamp;	// timestamp in ticks when the edge was detected; see ultrasonicMeter_getTimestamp
+} EchoEvent;
+#endif
+
+// one sensor channel (a trigger/echo pair) and the values of its current measurement cycle
+typedef struct
+{
+	sint32 measuredDistances[MAX_MEASUREMENTS];	// all the measured values in 1/DISTANCE_UNITS_PER_MM mm; DISTANCE_OUT_OF_RANGE or DISTANCE_LOST if the value is invalid
+	unsigned char measuredDistancesIndex;	// the index in the measuredDistances array
+	unsigned char validDistancesCount;	// count of the valid measured values in the current cycle
+	unsigned char lostShotsCount;	// count of the shots without echo in the current cycle
+	unsigned char outOfRangeShotsCount;	// count of the shots with an echo out of the measurement range in the current cycle
+	unsigned short timeToFirstEcho;	// milliseconds from the start of the current cycle to the first valid echo; QUALITY_NO_ECHO_TIME if there is none
+	unsigned char isFinished;	// TRUE if the channel has finished the current cycle
+	sint32 spread;	// difference between the max and the min valid measured value of the current cycle in 1/DISTANCE_UNITS_PER_MM mm
+	sint32 jitter;	// mean absolute difference of consecutive valid measured values of the current cycle in 1/DISTANCE_UNITS_PER_MM mm
+	sint32 waterLevel;	// the estimated water level of the last cycle in 1/DISTANCE_UNITS_PER_MM mm
+	sint32 dispersion;	// the dispersion (median absolute deviation) of the valid measured values of the last cycle in 1/DISTANCE_UNITS_PER_MM mm
+	unsigned int distanceEmpty;	// distance in millimeters water to ultrasonic sensor if the cistern is empty
+	unsigned int silenceTimespanMs;	// Duration for waiting for "silence" in milliseconds after an echo was received; derived from distanceEmpty
+	uint32 echoTimeoutUs;	// max time in µs from the trigger pulse to the end of the echo pulse; derived from distanceEmpty
+	uint32 nextShotTime;	// system time in µs when the echo of the last shot of the channel has decayed
+} UltrasonicChannel;
+
+#if SENSOR_HAS_ECHO_PULSE
+#ifdef ULTRASONIC_CCOUNT_CAPTURE
+// reads the timestamp for an echo edge; that's the CPU cycle counter (CCOUNT register)
+static inline uint32 ultrasonicMeter_getTimestamp()
+{
+	uint32 ccount;
+	__asm__ __volatile__("rsr %0, ccount" : "=a"(ccount));
+	return ccount;
+}
+#else
+// reads the timestamp for an echo edge; that's the system time in µs
+#define ultrasonicMeter_getTimestamp() system_get_time()
+#endif
+
+// the trigger pins of the sensor channels; see io.h
+static const unsigned char ultrasonicMeter_triggerGpios[] = { TRIGGER_GPIO, TRIGGER_GPIO_2 };
+// the echo pins of the sensor channels; see io.h
+static const unsigned char ultrasonicMeter_echoGpios[] = { ECHO_GPIO, ECHO_GPIO_2 };
 // Echo start timestamp
 static uint32 ultrasonicMeter_startTime;
 // Echo stop timestamp
 static uint32 ultrasonicMeter_stopTime;
+// timestamp ticks per µs; the CPU frequency in MHz if the cycle counter is used, otherwise 1
+static uint32 ultrasonicMeter_ticksPerUs = 1;
+
+// single producer (interrupt handler) / single consumer (system task) ring buffer for the echo edges
+static EchoEvent ultrasonicMeter_echoEvents[ECHO_EVENTS_SIZE];
+// next write index; only modified by the interrupt handler
+static volatile unsigned char ultrasonicMeter_echoEventsHead = 0;
+// next read index; only modified by the system task
+static volatile unsigned char ultrasonicMeter_echoEventsTail = 0;
+// the queue for the system task
+static os_event_t ultrasonicMeter_taskQueue[ULTRASONIC_TASK_QUEUE_SIZE];
+// TRUE if the system task is registered
+static unsigned char ultrasonicMeter_isTaskRegistered = FALSE;
+#endif
 
-// the timer for stating a new cycle
-static ETSTimer ultrasonicMeter_triggerNewCycleTimer;
+// the sensor channels
+static UltrasonicChannel ultrasonicMeter_channels[ULTRASONIC_CHANNEL_COUNT];
+// the channel that fires the current shot; only one shot is on the way at a time
+static volatile unsigned char ultrasonicMeter_currentChannel = 0;
+// max count of shots per channel in one measurement cycle; MAX_MEASUREMENTS or less
+static unsigned char ultrasonicMeter_maxShots = MAX_MEASUREMENTS;
+// FALSE if the measurement cycles always fire ultrasonicMeter_maxShots shots; see ULTRASONIC_EARLY_STOP
+static unsigned char ultrasonicMeter_isEarlyStopEnabled = TRUE;
+// current state; the interrupt handler switches from WAITFOR_ECHO_POSITIVE_EDGE to WAITFOR_ECHO_NEGATIVE_EDGE to WAITFOR_SILENCE
+static volatile unsigned char ultrasonicMeter_currentState = WAITFOR_NOTHING;
+// system time in µs when the current measurement cycle was started
+static uint32 ultrasonicMeter_cycleStartTime;
+#ifdef SENSOR_POWER_GATING
+// the timer for waiting until the sensors are settled after switching them on
+static ETSTimer ultrasonicMeter_sensorSettleTimer;
+// settle time of the sensors of the current measurement cycle in milliseconds
+static unsigned short ultrasonicMeter_sensorSettleTime;
+#endif
 
 // call this function after all measurements are done
 static ultrasonicMeter_finishedCallback *ultrasonicMeter_finished = NULL;
 
 static unsigned char ultrasonicMeter_isSingleShotMode = FALSE;
 
-// gets the echo quality: 0 = no echo received; MAX_MEASUREMENTS = best possible; all MAX_MEASUREMENTS measurements are received
-unsigned char ICACHE_FLASH_ATTR ultrasonicMeter_getEchoQuality()
+// gets the quality of the last measurement cycle of the channel
+void ICACHE_FLASH_ATTR ultrasonicMeter_getQuality(unsigned char pChannel, MeasurementQuality *pQuality)
+{
+	UltrasonicChannel *channel = &ultrasonicMeter_channels[pChannel];
+	pQuality->shotCount = channel->measuredDistancesIndex;
+	pQuality->validCount = channel->validDistancesCount;
+	pQuality->lostCount = channel->lostShotsCount;
+	pQuality->outOfRangeCount = channel->outOfRangeShotsCount;
+	pQuality->spread = (unsigned short)(channel->spread < 0xFFFF ? channel->spread : 0xFFFF);
+	pQuality->jitter = (unsigned short)(channel->jitter < 0xFFFF ? channel->jitter : 0xFFFF);
+	pQuality->timeToFirstEcho = channel->timeToFirstEcho;
+}
+
+// gets the count of shots of the channel that are fired in the last measurement cycle
+unsigned char ICACHE_FLASH_ATTR ultrasonicMeter_getShotCount(unsigned char pChannel)
+{
+	return ultrasonicMeter_channels[pChannel].measuredDistancesIndex;
+}
+
+// gets the count of valid shots of the channel in the last measurement cycle
+unsigned char ICACHE_FLASH_ATTR ultrasonicMeter_getValidShotCount(unsigned char pChannel)
+{
+	return ultrasonicMeter_channels[pChannel].validDistancesCount;
+}
+
+// sets the max count of shots per channel for the next measurement cycles; limited to MAX_MEASUREMENTS
+void ICACHE_FLASH_ATTR ultrasonicMeter_setMaxShots(unsigned char pMaxShots)
+{
+	ultrasonicMeter_maxShots = (pMaxShots > 0 && pMaxShots < MAX_MEASUREMENTS) ? pMaxShots : MAX_MEASUREMENTS;
+}
+
+// enables or disables the early stop of the next measurement cycles; enabled by default; no effect without ULTRASONIC_EARLY_STOP
+void ICACHE_FLASH_ATTR ultrasonicMeter_setEarlyStop(unsigned char pIsEnabled)
+{
+	ultrasonicMeter_isEarlyStopEnabled = pIsEnabled;
+}
+
+// gets the difference between the max and the min valid distance of the channel of the last measurement cycle in 1/DISTANCE_UNITS_PER_MM mm
+sint32 ICACHE_FLASH_ATTR ultrasonicMeter_getSpread(unsigned char pChannel)
+{
+	return ultrasonicMeter_channels[pChannel].spread;
+}
+
+// gets the distance of the channel that is measured in single shot mode in 1/DISTANCE_UNITS_PER_MM mm
+sint32 ICACHE_FLASH_ATTR ultrasonicMeter_getSingleShotDistance(unsigned char pChannel)
+{
+	return ultrasonicMeter_channels[pChannel].measuredDistances[0];
+}
+
+// gets the distances of all shots of the channel of the last measurement cycle in 1/DISTANCE_UNITS_PER_MM mm; negative if the shot is invalid
+// the count of distances is ultrasonicMeter_getShotCount
+const sint32* ICACHE_FLASH_ATTR ultrasonicMeter_getDistances(unsigned char pChannel)
+{
+	return ultrasonicMeter_channels[pChannel].measuredDistances;
+}
+
+// gets the estimated water level of the channel in 1/DISTANCE_UNITS_PER_MM mm; see ULTRASONIC_ESTIMATOR
+sint32 ICACHE_FLASH_ATTR ultrasonicMeter_getWaterLevel(unsigned char pChannel)
+{
+	return ultrasonicMeter_channels[pChannel].waterLevel;
+}
+
+// gets the dispersion (median absolute deviation) of the valid distances of the channel of the last measurement cycle in 1/DISTANCE_UNITS_PER_MM mm
+sint32 ICACHE_FLASH_ATTR ultrasonicMeter_getDispersion(unsigned char pChannel)
 {
-	return ultrasonicMeter_valueQuality;
+	return ultrasonicMeter_channels[pChannel].dispersion;
 }
 
-// gets the distance that is measured in single shot mode
-float ICACHE_FLASH_ATTR ultrasonicMeter_getSingleShotDistance()
+// estimates the water level and the dispersion of the channel from the measured values of the current cycle
+static void ICACHE_FLASH_ATTR ultrasonicMeter_estimateWaterLevel(UltrasonicChannel *pChannel)
 {
-	return ultrasonicMeter_measuredDistances[0];
+	sint32 distance;
+	if (estimator_estimate(ULTRASONIC_ESTIMATOR, pChannel->measuredDistances, pChannel->measuredDistancesIndex,
+		&distance, &pChannel->dispersion) > 0)
+	{
+		pChannel->waterLevel = (sint32)pChannel->distanceEmpty * DISTANCE_UNITS_PER_MM - distance;
+	}
+	else
+	{
+		pChannel->waterLevel = 0;
+	}
 }
 
-// gets the mean value of measured water level
-float ICACHE_FLASH_ATTR ultrasonicMeter_getWaterLevel()
+// stores the distance of one shot of the channel in 1/DISTANCE_UNITS_PER_MM mm; DISTANCE_OUT_OF_RANGE or DISTANCE_LOST if the distance is invalid
+static void ICACHE_FLASH_ATTR ultrasonicMeter_storeDistance(UltrasonicChannel *pChannel, sint32 distance)
 {
-	int valueCount = 0;
-	float sum = 0;
-	float min = 10000.0;
-	float max = 0.0;
-	for (int i = 0; i < MAX_MEASUREMENTS; i++)
+	// store the measured value
+	pChannel->measuredDistances[pChannel->measuredDistancesIndex] = distance;
+	pChannel->measuredDistancesIndex++;
+	os_printf("Distance[%d] = %d mm\n", (int)(pChannel - ultrasonicMeter_channels), (int)(distance / DISTANCE_UNITS_PER_MM));
+
+	// count the faults for the quality of the cycle
+	if (distance > 0)
 	{
-		if (ultrasonicMeter_measuredDistances[i] > 0)
+		if (pChannel->timeToFirstEcho == QUALITY_NO_ECHO_TIME)
 		{
-			sum += ultrasonicMeter_measuredDistances[i];
-			if (ultrasonicMeter_measuredDistances[i] < min)
+			uint32 elapsedMs = (system_get_time() - ultrasonicMeter_cycleStartTime) / 1000;
+			pChannel->timeToFirstEcho = (unsigned short)(elapsedMs < QUALITY_NO_ECHO_TIME ? elapsedMs : QUALITY_NO_ECHO_TIME - 1);
+		}
+	}
+	else if (distance == DISTANCE_LOST)
+	{
+		pChannel->lostShotsCount++;
+	}
+	else
+	{
+		pChannel->outOfRangeShotsCount++;
+	}
+}
+
+// updates the count of valid values, the spread and the jitter of the valid values of the channel in the current cycle
+static void ICACHE_FLASH_ATTR ultrasonicMeter_updateSpread(UltrasonicChannel *pChannel)
+{
+	sint32 min = 0x7FFFFFFF;
+	sint32 max = 0;
+	sint32 previous = 0;
+	sint32 sumOfDifferences = 0;
+	pChannel->validDistancesCount = 0;
+	for (int i = 0; i < pChannel->measuredDistancesIndex; i++)
+	{
+		if (pChannel->measuredDistances[i] > 0)
+		{
+			if (pChannel->measuredDistances[i] < min)
 			{
-				min = ultrasonicMeter_measuredDistances[i];
+				min = pChannel->measuredDistances[i];
 			}
-			if (ultrasonicMeter_measuredDistances[i] > max)
+			if (pChannel->measuredDistances[i] > max)
 			{
-				max = ultrasonicMeter_measuredDistances[i];
+				max = pChannel->measuredDistances[i];
 			}
-			valueCount++;
+			// the difference to the valid value before; the invalid values in between are skipped
+			if (pChannel->validDistancesCount > 0)
+			{
+				sumOfDifferences += pChannel->measuredDistances[i] > previous ? pChannel->measuredDistances[i] - previous : previous - pChannel->measuredDistances[i];
+			}
+			previous = pChannel->measuredDistances[i];
+			pChannel->validDistancesCount++;
+		}
+	}
+	pChannel->spread = (pChannel->validDistancesCount > 0) ? max - min : 0;
+	pChannel->jitter = (pChannel->validDistancesCount > 1) ? (sumOfDifferences + (pChannel->validDistancesCount - 1) / 2) / (pChannel->validDistancesCount - 1) : 0;
+}
+
+// delivers TRUE if the current measurement cycle of the channel is finished
+static unsigned char ICACHE_FLASH_ATTR ultrasonicMeter_isCycleFinished(UltrasonicChannel *pChannel)
+{
+	// array for measured values full or single shot mode?
+	if (pChannel->measuredDistancesIndex >= ultrasonicMeter_maxShots ||
+		(pChannel->measuredDistancesIndex == 1 && ultrasonicMeter_isSingleShotMode == TRUE))
+	{
+		return TRUE;
+	}
+#if ULTRASONIC_SENSOR == SENSOR_UART
+	// enough filtered values?
+	if (pChannel->validDistancesCount >= UART_SENSOR_VALID_FRAMES)
+	{
+		return TRUE;
+	}
+#endif
+#ifdef ULTRASONIC_EARLY_STOP
+	// enough consistent values?
+	if (ultrasonicMeter_isEarlyStopEnabled == TRUE &&
+		pChannel->validDistancesCount >= EARLY_STOP_MIN_SHOTS && pChannel->spread <= EARLY_STOP_MAX_SPREAD_MM * DISTANCE_UNITS_PER_MM)
+	{
+		return TRUE;
+	}
+#endif
+	return FALSE;
+}
+
+// delivers TRUE if the current measurement cycle of all channels is finished
+static unsigned char ICACHE_FLASH_ATTR ultrasonicMeter_areAllChannelsFinished()
+{
+	for (int i = 0; i < ULTRASONIC_CHANNEL_COUNT; i++)
+	{
+		if (ultrasonicMeter_channels[i].isFinished == FALSE)
+		{
+			return FALSE;
 		}
 	}
-	// do we have at least 3 values?
-	if (valueCount >= 3)
+	return TRUE;
+}
+
+// the sensor driver; see ULTRASONIC_SENSOR
+// starts the shots of a measurement cycle
+static void ICACHE_FLASH_ATTR ultrasonicMeter_startShots();
+// fires the next shot after a shot was finished
+static void ICACHE_FLASH_ATTR ultrasonicMeter_nextShot();
+// stops the shots at the end of a measurement cycle
+static void ICACHE_FLASH_ATTR ultrasonicMeter_stopShots();
+
+#ifdef SENSOR_POWER_GATING
+// tunes the settle time of the sensors with the validity of the first shots of the current measurement cycle and saves it in RTC memory
+static void ICACHE_FLASH_ATTR ultrasonicMeter_tuneSensorSettleTime()
+{
+	unsigned char isTooShort = FALSE;
+	unsigned char areFirstShotsValid = TRUE;
+	for (int i = 0; i < ULTRASONIC_CHANNEL_COUNT; i++)
+	{
+		UltrasonicChannel *channel = &ultrasonicMeter_channels[i];
+		if (channel->measuredDistancesIndex > 0 && channel->measuredDistances[0] <= 0)
+		{
+			areFirstShotsValid = FALSE;
+			// a later shot is valid; so the sensor wasn't ready for the first one
+			if (channel->validDistancesCount > 0)
+			{
+				isTooShort = TRUE;
+			}
+		}
+	}
+	unsigned short settleTime = ultrasonicMeter_sensorSettleTime;
+	if (isTooShort == TRUE)
+	{
+		settleTime += settleTime / 2;
+		if (settleTime > SENSOR_SETTLE_MAX_MS)
+		{
+			settleTime = SENSOR_SETTLE_MAX_MS;
+		}
+	}
+	else if (areFirstShotsValid == TRUE)
+	{
+		settleTime = (settleTime > SENSOR_SETTLE_MIN_MS + SENSOR_SETTLE_DECREASE_MS) ? settleTime - SENSOR_SETTLE_DECREASE_MS : SENSOR_SETTLE_MIN_MS;
+	}
+	powermanagement_setSensorSettleTime(settleTime);
+}
+#endif
+
+// stops the measurement and calls the finished callback
+static void ICACHE_FLASH_ATTR ultrasonicMeter_finish()
+{
+	ultrasonicMeter_stopShots();
+#ifdef SENSOR_POWER_GATING
+	// switch the sensors off until the next measurement cycle
+	io_sensorPower(0);
+	ultrasonicMeter_tuneSensorSettleTime();
+#endif
+	// set the state
+	ultrasonicMeter_currentState = FINISHED;
+#ifdef ULTRASONIC_TRACE
+	trace_save();
+#endif
+	for (int i = 0; i < ULTRASONIC_CHANNEL_COUNT; i++)
+	{
+		ultrasonicMeter_estimateWaterLevel(&ultrasonicMeter_channels[i]);
+	}
+	// callback
+	if (ultrasonicMeter_finished != NULL)
+	{
+		ultrasonicMeter_finished();
+	}
+}
+
+// finishes the current shot of the channel; stops the measurement if all channels are finished, otherwise the next shot is scheduled
+// pDistance: the distance of the shot in 1/DISTANCE_UNITS_PER_MM mm; DISTANCE_OUT_OF_RANGE or DISTANCE_LOST if the distance is invalid
+static void ICACHE_FLASH_ATTR ultrasonicMeter_finishShot(UltrasonicChannel *pChannel, sint32 pDistance)
+{
+	ultrasonicMeter_storeDistance(pChannel, pDistance);
+	ultrasonicMeter_updateSpread(pChannel);
+	pChannel->isFinished = ultrasonicMeter_isCycleFinished(pChannel);
+
+	// do we have finished?
+	if (ultrasonicMeter_areAllChannelsFinished() == TRUE)
+	{
+		// then stop
+		ultrasonicMeter_finish();
+	}
+	else
 	{
-		// then cut the min an max value
-		sum = sum - max - min;
-		valueCount -= 2;
+		ultrasonicMeter_nextShot();
 	}
-	return (valueCount > 0) ? (float)configuration_getDistanceEmpty() - sum / valueCount : 0.0;
+}
+
+#if SENSOR_HAS_ECHO_PULSE
+// driver for the sensors with trigger pin and echo pulse (HC-SR04, JSN-SR04T)
+
+// the channel fires its next shot after the given timespan in milliseconds; that's the time the echo of the last shot needs to decay
+static void ICACHE_FLASH_ATTR ultrasonicMeter_setSilence(UltrasonicChannel *pChannel, unsigned int pSilenceTimespanMs)
+{
+	pChannel->nextShotTime = system_get_time() + pSilenceTimespanMs * 1000;
+}
+
+// stores an echo edge in the ring buffer if there is room for it and lets the system task do the rest
+// only called by the interrupt handlers; they don't interrupt each other
+static inline void ultrasonicMeter_pushEchoEvent(unsigned char edge, unsigned char channel, uint32 timestamp)
+{
+	unsigned char head = ultrasonicMeter_echoEventsHead;
+	unsigned char nextHead = (head + 1) & (ECHO_EVENTS_SIZE - 1);
+	if (nextHead != ultrasonicMeter_echoEventsTail)
+	{
+		ultrasonicMeter_echoEvents[head].edge = edge;
+		ultrasonicMeter_echoEvents[head].channel = channel;
+		ultrasonicMeter_echoEvents[head].timestamp = timestamp;
+		ultrasonicMeter_echoEventsHead = nextHead;
+	}
+	system_os_post(ULTRASONIC_TASK_PRIO, 0, 0);
 }
 
 // interrupt handler
-// this function will be executed on any edge of ECHO_GPIO
-static void ICACHE_FLASH_ATTR ultrasonicMeter_gpioEvent(void *args)
+// this function will be executed on any edge of the echo pin of the current channel; it only records the edge and the timestamp
+// all the calculations are done later in ultrasonicMeter_processEchoEvents
+// the handler is placed in IRAM (no ICACHE_FLASH_ATTR) so a flash cache miss can't delay the timestamp
+static void ultrasonicMeter_gpioEvent(void *args)
 {
+	// take the timestamp first
+	uint32 timestamp = ultrasonicMeter_getTimestamp();
 	// read interrupt status
 	uint32 gpio_status = GPIO_REG_READ(GPIO_STATUS_ADDRESS);
+	unsigned char channel = ultrasonicMeter_currentChannel;
+	unsigned char echoGpio = ultrasonicMeter_echoGpios[channel];
 
-	// if the interrupt was by ECHO_GPIO
-	if (gpio_status & BIT(ECHO_GPIO))
+	// if the interrupt was by the echo pin of the current channel
+	if (gpio_status & BIT(echoGpio))
 	{
+		unsigned char edge = ultrasonicMeter_currentState;
+
 		// clear interrupt status
-		GPIO_REG_WRITE(GPIO_STATUS_W1TC_ADDRESS, gpio_status & BIT(ECHO_GPIO));
+		GPIO_REG_WRITE(GPIO_STATUS_W1TC_ADDRESS, gpio_status & BIT(echoGpio));
 
 		// are we waiting for the positive edge?
-		if (ultrasonicMeter_currentState == WAITFOR_ECHO_POSITIVE_EDGE)
+		if (edge == WAITFOR_ECHO_POSITIVE_EDGE)
 		{
 			// wait for the negative edge
-			gpio_pin_intr_state_set(GPIO_ID_PIN(ECHO_GPIO), GPIO_PIN_INTR_NEGEDGE);
-
-			// set start timestamp and set the next state 
-			ultrasonicMeter_startTime = system_get_time();
+			gpio_pin_intr_state_set(GPIO_ID_PIN(echoGpio), GPIO_PIN_INTR_NEGEDGE);
 			ultrasonicMeter_currentState = WAITFOR_ECHO_NEGATIVE_EDGE;
 		}
 		// are we waiting for the negative edge?
-		else if (ultrasonicMeter_currentState == WAITFOR_ECHO_NEGATIVE_EDGE)
+		else if (edge == WAITFOR_ECHO_NEGATIVE_EDGE)
+		{
+			// disable interupt and the echo timeout
+			gpio_pin_intr_state_set(GPIO_ID_PIN(echoGpio), GPIO_PIN_INTR_DISABLE);
+			hwtimer_disarm();
+			ultrasonicMeter_currentState = WAITFOR_SILENCE;
+		}
+		else
 		{
-			// disable interupt
-			gpio_pin_intr_state_set(GPIO_ID_PIN(ECHO_GPIO), GPIO_PIN_INTR_DISABLE);
+			// unexpected edge
+			return;
+		}
+
+		ultrasonicMeter_pushEchoEvent(edge, channel, timestamp);
+	}
+}
+
+// interrupt handler of the hardware timer; drives the shot of the current channel
+// starts and ends the trigger pulse and ends the shot if the echo wasn't received in time
+// placed in IRAM like ultrasonicMeter_gpioEvent
+static void ultrasonicMeter_hwTimerEvent()
+{
+	uint32 timestamp = ultrasonicMeter_getTimestamp();
+	unsigned char channel = ultrasonicMeter_currentChannel;
+	unsigned char triggerGpio = ultrasonicMeter_triggerGpios[channel];
+	unsigned char echoGpio = ultrasonicMeter_echoGpios[channel];
 
-			// set stop timestamp and set the next state 
-			ultrasonicMeter_stopTime = system_get_time();
+	switch (ultrasonicMeter_currentState)
+	{
+		// start the trigger pulse
+	case WAITFOR_TRIGGER_START:
+		// the echo pin must be low; otherwise the shot is lost
+		if (GPIO_INPUT_GET(echoGpio))
+		{
 			ultrasonicMeter_currentState = WAITFOR_SILENCE;
+			ultrasonicMeter_pushEchoEvent(NO_ECHO, channel, timestamp);
+			break;
+		}
+		gpio_output_set((1 << triggerGpio), 0, (1 << triggerGpio), 0);
+		ultrasonicMeter_currentState = WAITFOR_TRIGGER_END;
+		hwtimer_arm(SENSOR_TRIGGER_PULSE_US);
+#ifdef ULTRASONIC_TRACE
+		ultrasonicMeter_pushEchoEvent(TRIGGER_STARTED, channel, timestamp);
+#endif
+		break;
 
-			// calculate distance
-			float distance = ((float)ultrasonicMeter_stopTime - (float)ultrasonicMeter_startTime) / (float)US_PER_MM;
-			// distance wider than expected?
-			if (distance > (float)configuration_getDistanceEmpty())
-			{
-				distance = -1;
-			}
-			// store the measured value
-			ultrasonicMeter_measuredDistances[ultrasonicMeter_measuredDistancesIndex] = distance;
-			ultrasonicMeter_measuredDistancesIndex++;
-			os_printf("Distance = %d mm\n", (int)distance);
+		// end the trigger pulse and wait for the echo
+	case WAITFOR_TRIGGER_END:
+		gpio_output_set(0, (1 << triggerGpio), (1 << triggerGpio), 0);
+		ultrasonicMeter_currentState = WAITFOR_ECHO_POSITIVE_EDGE;
+		// trigger interrupt on positive edge on echo pin
+		gpio_pin_intr_state_set(GPIO_ID_PIN(echoGpio), GPIO_PIN_INTR_POSEDGE);
+		// if the echo isn't received in time the shot is lost
+		hwtimer_arm(ultrasonicMeter_channels[channel].echoTimeoutUs);
+		break;
 
-			// if the distance is negative we have a fault during receiving the ultrasonic echo
-			if (distance > 0.0)
-			{
-				// Increment the echo receiving quality
-				if (ultrasonicMeter_valueQuality < MAX_MEASUREMENTS)
-				{
-					ultrasonicMeter_valueQuality++;
-				}
-			}
-			// Measurement fault!
-			else
-			{
-				// Increment the echo receiving quality
-				if (ultrasonicMeter_valueQuality > 0)
-				{
-					ultrasonicMeter_valueQuality--;
-				}
-			}
+		// the echo wasn't received in time; ignore the echo pin from now on
+	case WAITFOR_ECHO_POSITIVE_EDGE:
+	case WAITFOR_ECHO_NEGATIVE_EDGE:
+		gpio_pin_intr_state_set(GPIO_ID_PIN(echoGpio), GPIO_PIN_INTR_DISABLE);
+		ultrasonicMeter_currentState = WAITFOR_SILENCE;
+		ultrasonicMeter_pushEchoEvent(NO_ECHO, channel, timestamp);
+		break;
+	}
+}
+
+// calculates the distance of one received echo of the channel in 1/DISTANCE_UNITS_PER_MM mm; DISTANCE_OUT_OF_RANGE if the distance is invalid
+static sint32 ICACHE_FLASH_ATTR ultrasonicMeter_calculateDistance(UltrasonicChannel *pChannel)
+{
+	// calculate distance; the unsigned difference is also valid if the timestamp has wrapped around
+	// distance = ticks * 10 * DISTANCE_UNITS_PER_MM / (ticks per cm); split up into quotient and remainder to avoid an overflow
+	uint32 ticks = ultrasonicMeter_stopTime - ultrasonicMeter_startTime;
+	uint32 ticksPerCm = ultrasonicMeter_ticksPerUs * US_PER_CM;
+	sint32 distance = (sint32)((ticks / ticksPerCm) * 10 * DISTANCE_UNITS_PER_MM + (ticks % ticksPerCm) * 10 * DISTANCE_UNITS_PER_MM / ticksPerCm);
+	// distance wider than expected or in the blind zone of the sensor?
+	if (distance > (sint32)pChannel->distanceEmpty * DISTANCE_UNITS_PER_MM || distance < SENSOR_MIN_DISTANCE_MM * DISTANCE_UNITS_PER_MM)
+	{
+		distance = DISTANCE_OUT_OF_RANGE;
+	}
+	return distance;
+}
+
+// selects the channel for the next shot; the channels take turns so the silence timespan of one channel
+// overlaps the shot of the next channel
+// returns the time in µs until the echo of the last shot of the selected channel has decayed
+static uint32 ICACHE_FLASH_ATTR ultrasonicMeter_selectNextChannel()
+{
+	unsigned char channel = ultrasonicMeter_currentChannel;
+	for (int i = 0; i < ULTRASONIC_CHANNEL_COUNT; i++)
+	{
+		channel = (channel + 1) % ULTRASONIC_CHANNEL_COUNT;
+		if (ultrasonicMeter_channels[channel].isFinished == FALSE)
+		{
+			break;
 		}
 	}
+	ultrasonicMeter_currentChannel = channel;
+
+	// the signed difference is also valid if the system time has wrapped around
+	sint32 remainingUs = (sint32)(ultrasonicMeter_channels[channel].nextShotTime - system_get_time());
+	return (remainingUs > 0) ? (uint32)remainingUs : 0;
+}
+
+// schedules the next single shot measurement of the current channel after the given delay in µs
+// the hardware timer is idle here; it fires the trigger pulse (see ultrasonicMeter_hwTimerEvent)
+static void ICACHE_FLASH_ATTR ultrasonicMeter_scheduleNextShot(uint32 delayUs)
+{
+	io_ledPulse(100);
+	ultrasonicMeter_currentState = WAITFOR_TRIGGER_START;
+	hwtimer_arm(delayUs);
+}
 
-	// do we have finished (array for measured values full) or single shot mode?
-	if (ultrasonicMeter_measuredDistancesIndex == MAX_MEASUREMENTS ||
-		(ultrasonicMeter_measuredDistancesIndex == 1 && ultrasonicMeter_isSingleShotMode == TRUE))
+// processes the echo edges that are recorded by the interrupt handlers
+// returns TRUE if the measurement is finished
+static unsigned char ICACHE_FLASH_ATTR ultrasonicMeter_processEchoEvents()
+{
+	while (ultrasonicMeter_currentState != FINISHED && ultrasonicMeter_echoEventsTail != ultrasonicMeter_echoEventsHead)
 	{
-		// then stop
-		// Disable interrupts by GPIO and disarm the timer
-		ETS_GPIO_INTR_DISABLE();
-		os_timer_disarm(&ultrasonicMeter_triggerNewCycleTimer);
-		// set the state
-		ultrasonicMeter_currentState = FINISHED;
-		// callback
-		if (ultrasonicMeter_finished != NULL)
+		// copy the edge and release the slot in the ring buffer
+		EchoEvent echoEvent = ultrasonicMeter_echoEvents[ultrasonicMeter_echoEventsTail];
+		ultrasonicMeter_echoEventsTail = (ultrasonicMeter_echoEventsTail + 1) & (ECHO_EVENTS_SIZE - 1);
+		UltrasonicChannel *channel = &ultrasonicMeter_channels[echoEvent.channel];
+		unsigned char edge = echoEvent.edge;
+		uint32 timestamp = echoEvent.timestamp;
+#ifdef ULTRASONIC_TRACE
+		trace_record(edge == TRIGGER_STARTED ? TRACE_TRIGGER : (edge == WAITFOR_ECHO_POSITIVE_EDGE ? TRACE_RISING_EDGE :
+			(edge == WAITFOR_ECHO_NEGATIVE_EDGE ? TRACE_FALLING_EDGE : TRACE_TIMEOUT)), echoEvent.channel, timestamp);
+#endif
+		if (edge == TRIGGER_STARTED)
+		{
+			// only recorded for the trace
+			continue;
+		}
+		else if (edge == WAITFOR_ECHO_POSITIVE_EDGE)
+		{
+			ultrasonicMeter_startTime = timestamp;
+		}
+		else if (edge == WAITFOR_ECHO_NEGATIVE_EDGE)
 		{
-			ultrasonicMeter_finished();
+			ultrasonicMeter_stopTime = timestamp;
+			ultrasonicMeter_setSilence(channel, channel->silenceTimespanMs);
+			ultrasonicMeter_finishShot(channel, ultrasonicMeter_calculateDistance(channel));
+		}
+		else
+		{
+			// no echo; the shot is lost
+			os_printf("No echo!\n");
+			ultrasonicMeter_setSilence(channel, SENSOR_NO_ECHO_SILENCE_TIMESPAN_MS);
+			ultrasonicMeter_finishShot(channel, DISTANCE_LOST);
 		}
 	}
+	return ultrasonicMeter_currentState == FINISHED;
 }
 
-// triggers a new ultrasonic measurement cycle
-static void ICACHE_FLASH_ATTR ultrasonicMeter_triggerNewCycle(void *arg)
+// system task; called after the interrupt handler has recorded an echo edge
+static void ICACHE_FLASH_ATTR ultrasonicMeter_task(os_event_t *event)
 {
-	if (ultrasonicMeter_measuredDistancesIndex == 0)
+	ultrasonicMeter_processEchoEvents();
+}
+
+// starts the shots of a measurement cycle
+static void ICACHE_FLASH_ATTR ultrasonicMeter_startShots()
+{
+	// register the system task for processing the echo edges
+	if (ultrasonicMeter_isTaskRegistered == FALSE)
 	{
-		os_printf("Starting range measurement...\n");
-		os_timer_disarm(&ultrasonicMeter_triggerNewCycleTimer);
-		os_timer_setfn(&ultrasonicMeter_triggerNewCycleTimer, ultrasonicMeter_triggerNewCycle, NULL);
-		os_timer_arm(&ultrasonicMeter_triggerNewCycleTimer, SILENCE_TIMESPAN_MS, 1);
+		system_os_task(ultrasonicMeter_task, ULTRASONIC_TASK_PRIO, ultrasonicMeter_taskQueue, ULTRASONIC_TASK_QUEUE_SIZE);
+		ultrasonicMeter_isTaskRegistered = TRUE;
 	}
-	// test the current state
-	if (ultrasonicMeter_currentState != WAITFOR_SILENCE && ultrasonicMeter_currentState != WAITFOR_NOTHING)
+
+	// Attach interrupt handle to gpio interrupts.
+	ETS_GPIO_INTR_ATTACH(ultrasonicMeter_gpioEvent, NULL);
+	// Disable interrupts by GPIO
+	ETS_GPIO_INTR_DISABLE();
+	for (int i = 0; i < ULTRASONIC_CHANNEL_COUNT; i++)
+	{
+		unsigned char echoGpio = ultrasonicMeter_echoGpios[i];
+		// not sure why I should call this but found it in several examples
+		gpio_register_set(GPIO_PIN_ADDR(echoGpio), GPIO_PIN_INT_TYPE_SET(GPIO_PIN_INTR_DISABLE)
+			| GPIO_PIN_PAD_DRIVER_SET(GPIO_PAD_DRIVER_DISABLE)
+			| GPIO_PIN_SOURCE_SET(GPIO_AS_PIN_SOURCE));
+		// Clear interrupt status
+		GPIO_REG_WRITE(GPIO_STATUS_W1TC_ADDRESS, BIT(echoGpio));
+	}
+	// Enable interrupts by GPIO
+	ETS_GPIO_INTR_ENABLE();
+	// the hardware timer drives the shots
+	hwtimer_init(ultrasonicMeter_hwTimerEvent);
+
+	for (int i = 0; i < ULTRASONIC_CHANNEL_COUNT; i++)
 	{
-		// Empfangsqualitt verschlechtern!
-		if (ultrasonicMeter_valueQuality > 0)
+		UltrasonicChannel *channel = &ultrasonicMeter_channels[i];
+		// the worst case round trip time is the echo time for the empty cistern
+		channel->silenceTimespanMs = SILENCE_ROUND_TRIPS * channel->distanceEmpty * US_PER_CM / 10 / 1000;
+		if (channel->silenceTimespanMs < SENSOR_MIN_SILENCE_TIMESPAN_MS)
 		{
-			ultrasonicMeter_valueQuality--;
+			channel->silenceTimespanMs = SENSOR_MIN_SILENCE_TIMESPAN_MS;
 		}
+		channel->echoTimeoutUs = channel->distanceEmpty * US_PER_CM / 10 + ECHO_TIMEOUT_MARGIN_US;
+		// there was no shot before; the channel is silent
+		channel->nextShotTime = system_get_time();
 	}
+	ultrasonicMeter_currentChannel = 0;
+	ultrasonicMeter_echoEventsTail = ultrasonicMeter_echoEventsHead;
+	ultrasonicMeter_scheduleNextShot(0);
+}
 
-	if (GPIO_INPUT_GET(ECHO_GPIO))
+// fires the next shot as soon as the echo of the next channel has decayed
+static void ICACHE_FLASH_ATTR ultrasonicMeter_nextShot()
+{
+	ultrasonicMeter_scheduleNextShot(ultrasonicMeter_selectNextChannel());
+}
+
+// stops the shots at the end of a measurement cycle
+static void ICACHE_FLASH_ATTR ultrasonicMeter_stopShots()
+{
+	// Disable interrupts by GPIO and disarm the timer
+	ETS_GPIO_INTR_DISABLE();
+	hwtimer_disarm();
+}
+#else
+// driver for the sensors that send the distance as UART frame; every frame is one shot of the single channel
+
+// called by the UART sensor for every frame; pDistanceMm is -1 if no valid frame was received in time
+static void ICACHE_FLASH_ATTR ultrasonicMeter_uartFrame(sint32 pDistanceMm)
+{
+	UltrasonicChannel *channel = &ultrasonicMeter_channels[0];
+	sint32 distance = DISTANCE_OUT_OF_RANGE;
+
+	if (pDistanceMm < 0)
 	{
-		os_printf("Echo pin high! Next measurement not possible!\n");
-		return;
+		os_printf("No frame!\n");
+		distance = DISTANCE_LOST;
 	}
+	// distance in the measurement range?
+	else if (pDistanceMm >= SENSOR_MIN_DISTANCE_MM && pDistanceMm <= (sint32)channel->distanceEmpty)
+	{
+		distance = pDistanceMm * DISTANCE_UNITS_PER_MM;
+	}
+	ultrasonicMeter_finishShot(channel, distance);
+}
 
+// starts the shots of a measurement cycle
+static void ICACHE_FLASH_ATTR ultrasonicMeter_startShots()
+{
 	io_ledPulse(100);
-	ultrasonicMeter_currentState = WAITFOR_ECHO_POSITIVE_EDGE;
-	gpio_output_set((1 << TRIGGER_GPIO), 0, (1 << TRIGGER_GPIO), 0);
-	os_delay_us(TRIGGER_PULSE_US);
-	gpio_output_set(0, (1 << TRIGGER_GPIO), (1 << TRIGGER_GPIO), 0);
-	// trigger interrupt on positive edge on echo pin
-	gpio_pin_intr_state_set(GPIO_ID_PIN(ECHO_GPIO), GPIO_PIN_INTR_POSEDGE);
+	uartSensor_start(ultrasonicMeter_uartFrame);
 }
 
-// start the measurment process; that are MAX_MEASUREMENTS one shot ultrasonic measurement cycles
-// with pIsSingleShotMode set to TRUE one single shot measurement can also be started
+// the sensor sends the next frame on its own
+static void ICACHE_FLASH_ATTR ultrasonicMeter_nextShot()
+{
+}
+
+// stops the shots at the end of a measurement cycle
+static void ICACHE_FLASH_ATTR ultrasonicMeter_stopShots()
+{
+	uartSensor_stop();
+}
+#endif
+
+#ifdef SENSOR_POWER_GATING
+// timer function; the sensors are settled after switching them on
+static void ICACHE_FLASH_ATTR ultrasonicMeter_sensorSettled(void *arg)
+{
+	ultrasonicMeter_startShots();
+}
+#endif
+
+// start the measurment process; that are MAX_MEASUREMENTS one shot ultrasonic measurement cycles per channel
+// with pIsSingleShotMode set to TRUE one single shot measurement per channel can also be started
 void ICACHE_FLASH_ATTR ultrasonicMeter_startMeasurement(ultrasonicMeter_finishedCallback *pFinished, unsigned char pIsSingleShotMode)
 {
 	ultrasonicMeter_finished = pFinished;
 	ultrasonicMeter_isSingleShotMode = pIsSingleShotMode;
 
-	// Attach interrupt handle to gpio interrupts.
-	ETS_GPIO_INTR_ATTACH(ultrasonicMeter_gpioEvent, NULL);
-	// Disable interrupts by GPIO
-	ETS_GPIO_INTR_DISABLE();
-	// not sure why I should call this but found it in several examples
-	gpio_register_set(GPIO_PIN_ADDR(ECHO_GPIO), GPIO_PIN_INT_TYPE_SET(GPIO_PIN_INTR_DISABLE)
-		| GPIO_PIN_PAD_DRIVER_SET(GPIO_PAD_DRIVER_DISABLE)
-		| GPIO_PIN_SOURCE_SET(GPIO_AS_PIN_SOURCE));
-	// Clear interrupt status
-	GPIO_REG_WRITE(GPIO_STATUS_W1TC_ADDRESS, BIT(ECHO_GPIO));
-	// Enable interrupts by GPIO
-	ETS_GPIO_INTR_ENABLE();
-	
-	ultrasonicMeter_measuredDistancesIndex = 0;
-	ultrasonicMeter_triggerNewCycle(NULL);
+	ultrasonicMeter_cycleStartTime = system_get_time();
+
+#if SENSOR_HAS_ECHO_PULSE && defined(ULTRASONIC_CCOUNT_CAPTURE)
+	ultrasonicMeter_ticksPerUs = system_get_cpu_freq();
+#endif
+#ifdef ULTRASONIC_TRACE
+	// the single shot measurements of the configuration mode shouldn't overwrite the trace
+	if (ultrasonicMeter_isSingleShotMode == FALSE)
+	{
+		trace_start(ULTRASONIC_CHANNEL_COUNT, ultrasonicMeter_ticksPerUs);
+	}
+#endif
+	for (int i = 0; i < ULTRASONIC_CHANNEL_COUNT; i++)
+	{
+		UltrasonicChannel *channel = &ultrasonicMeter_channels[i];
+		channel->distanceEmpty = configuration_getDistanceEmpty(i);
+#ifdef ULTRASONIC_TRACE
+		trace_setDistanceEmpty(i, channel->distanceEmpty);
+#endif
+		channel->measuredDistancesIndex = 0;
+		channel->validDistancesCount = 0;
+		channel->lostShotsCount = 0;
+		channel->outOfRangeShotsCount = 0;
+		channel->timeToFirstEcho = QUALITY_NO_ECHO_TIME;
+		channel->spread = 0;
+		channel->jitter = 0;
+		channel->isFinished = FALSE;
+	}
+	os_printf("Starting range measurement...\n");
+	ultrasonicMeter_currentState = WAITFOR_NOTHING;
+#ifdef SENSOR_POWER_GATING
+	// switch the sensors on and start the shots after the settle time
+	ultrasonicMeter_sensorSettleTime = powermanagement_getSensorSettleTime();
+	if (ultrasonicMeter_sensorSettleTime == 0)
+	{
+		ultrasonicMeter_sensorSettleTime = SENSOR_SETTLE_INITIAL_MS;
+	}
+	os_printf("Sensor settle time: %d ms\n", ultrasonicMeter_sensorSettleTime);
+	io_sensorPower(1);
+	os_timer_disarm(&ultrasonicMeter_sensorSettleTimer);
+	os_timer_setfn(&ultrasonicMeter_sensorSettleTimer, ultrasonicMeter_sensorSettled, NULL);
+	os_timer_arm(&ultrasonicMeter_sensorSettleTimer, ultrasonicMeter_sensorSettleTime, 0);
+#else
+	ultrasonicMeter_startShots();
+#endif
 }
\ No newline at end of file
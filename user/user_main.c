@@ -33,6 +33,7 @@
 #include <powermanagement.h>
 #include <configuration.h>
 #include <posting.h>
+#include <continuous.h>
 #include <log.h>
 
 // Version number
@@ -86,10 +87,33 @@ void user_init(void)
 	{
 		return;
 	}
+	// continuous mode for mains-powered installations?
+	else if (configuration_getContinuousPeriod() > 0)
+	{
+		// the modem is only active after a wake up for posting
+		if (powermanagement_shouldPostMeasurement() == FALSE)
+		{
+			powermanagement_activateModem();
+		}
+		else
+		{
+			continuous_start();
+		}
+	}
 	// should we do a ultrasonic measurement
 	else if (powermanagement_shouldDoMeasurement() == TRUE)
 	{
 		wifi_set_opmode_current(NULL_MODE);
+#ifdef FORCED_MODEM_SLEEP
+		// the modem is powered down until the measurement calls for a post; see posting_checkIfPostNeeded
+		wifi_fpm_set_sleep_type(MODEM_SLEEP_T);
+		wifi_fpm_open();
+		wifi_fpm_do_sleep(FPM_SLEEP_MAX_TIME);
+#endif
+#ifdef LEVEL_FILTER
+		// with a settled level filter a few shots are sufficient
+		ultrasonicMeter_setMaxShots(powermanagement_isLevelFilterSettled() == TRUE && powermanagement_isSignalClean() == TRUE ? LEVEL_FILTER_SHOTS : 0);
+#endif
 		ultrasonicMeter_startMeasurement(posting_checkIfPostNeeded, FALSE);
 	}
 	// should we post the measured data?
@@ -99,14 +123,7 @@ void user_init(void)
 		io_ledSet(1);
 
 		// connect to Wifi
-		struct station_config stationConf;
-		wifi_set_opmode(STATION_MODE);
-		os_memset(&stationConf, 0, sizeof(struct station_config));
-		os_sprintf(stationConf.ssid, configuration_getWifiSsid());
-		os_sprintf(stationConf.password, configuration_getWifiPassword());
-		wifi_station_set_config_current(&stationConf);
-		wifi_set_event_handler_cb(posting_start);
-		wifi_station_connect();
+		posting_connectWifi(posting_start);
 
 		// init MQTT part
 		if (configuration_shouldPostToMqtt() == TRUE)
@@ -116,6 +133,14 @@ void user_init(void)
 
 		// enable the posting timeout timer
 		posting_startTimeoutTimer();
+
+#ifdef MEASURE_WHILE_POSTING
+		// measure while the module connects to the access point; so the fresh water levels are posted
+		if (powermanagement_shouldPostMeasurement() == TRUE)
+		{
+			posting_startMeasurement();
+		}
+#endif
 	}
 	else
 	{
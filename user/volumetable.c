@@ -0,0 +1,207 @@
+/*
+* ----------------------------------------------------------------------------
+* The MIT License (MIT)
+*
+* Copyright (c) 2016 - Matthias Jentsch
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+* ----------------------------------------------------------------------------
+*/
+
+#define M_PI 3.14159265358979323846
+
+#include "user_interface.h"
+#include "osapi.h"
+#include <espmissingincludes.h>
+#include <configuration.h>
+#include <ultrasonicmeter.h>
+#include <volumetable.h>
+
+// count of points per table
+#define VOLUME_TABLE_POINTS (VOLUME_TABLE_SEGMENTS + 1)
+// bits of the fraction of the table position; the position of a level is level * scale in segments
+#define VOLUME_TABLE_SCALE_BITS 24
+
+// the cistern parameters a table is built for
+typedef struct
+{
+	uint32 cisternType;	// cistern type; see configuration.c; 0 if there is no table for the channel
+	uint32 cisternRadius;	// cistern radius in millimeters; the bottom radius of the truncated cone
+	uint32 cisternLength;	// cistern length in millimeters; the length of the cylindrical part of the cylinder with domed ends
+	uint32 cisternWidth;	// cistern width in millimeters of the rectangular cistern
+	uint32 cisternHeight;	// cistern height in millimeters of the rectangular cistern and the truncated cone
+	uint32 cisternTopRadius;	// top radius in millimeters of the truncated cone
+	uint32 cisternDomeDepth;	// depth in millimeters of each of the ellipsoidal ends of the horizontal cylinder
+} VolumeTableShape;
+
+// water content per channel in milliliters at the water level of point * height / VOLUME_TABLE_SEGMENTS
+// the tables are only kept in RAM; they are built from the configuration on the first lookup of a wake up
+static uint32 volumetable_milliliters[ULTRASONIC_CHANNEL_COUNT][VOLUME_TABLE_POINTS];
+// TRUE if the tables are built in this wake up
+static unsigned char volumetable_isBuilt = FALSE;
+// per channel TRUE if the cistern of the channel is tabulated
+static unsigned char volumetable_isChannelValid[ULTRASONIC_CHANNEL_COUNT];
+// per channel the height of the table in 1/DISTANCE_UNITS_PER_MM mm
+static uint32 volumetable_heights[ULTRASONIC_CHANNEL_COUNT];
+// per channel the segments per 1/DISTANCE_UNITS_PER_MM mm with VOLUME_TABLE_SCALE_BITS fraction bits
+// precomputed so that a lookup only needs 32-bit multiplies and shifts instead of the soft 64-bit division
+static uint32 volumetable_scales[ULTRASONIC_CHANNEL_COUNT];
+
+// gets the current cistern parameters of the channel; returns FALSE if the cistern type is not tabulated
+static unsigned char ICACHE_FLASH_ATTR volumetable_getShape(unsigned char pChannel, VolumeTableShape *pShape)
+{
+	unsigned char cisternType;
+	unsigned int cisternRadius;
+	unsigned int cisternLength;
+	unsigned int distanceEmpty;
+	unsigned int litersFull;
+	unsigned int cisternWidth;
+	unsigned int cisternHeight;
+	unsigned int cisternTopRadius;
+	unsigned int cisternDomeDepth;
+
+	configuration_getCisternParameters(pChannel, &cisternType, &cisternRadius, &cisternLength, &distanceEmpty, &litersFull);
+	configuration_getCisternShape(pChannel, &cisternWidth, &cisternHeight, &cisternTopRadius, &cisternDomeDepth);
+	os_memset(pShape, 0, sizeof(VolumeTableShape));
+	// the vertical cylinder is linear and the strapping table has its own table; see strappingtable.h
+	if (cisternType != 1 && cisternType < 4)
+	{
+		return FALSE;
+	}
+	pShape->cisternType = cisternType;
+	pShape->cisternRadius = cisternRadius;
+	pShape->cisternLength = cisternLength;
+	pShape->cisternWidth = cisternWidth;
+	pShape->cisternHeight = cisternHeight;
+	pShape->cisternTopRadius = cisternTopRadius;
+	pShape->cisternDomeDepth = cisternDomeDepth;
+	return TRUE;
+}
+
+// the height in millimeters the table spans from the bottom to the top of the cistern
+static uint32 ICACHE_FLASH_ATTR volumetable_getHeight(const VolumeTableShape *pShape)
+{
+	switch (pShape->cisternType)
+	{
+	case 5:
+	case 6:
+		return pShape->cisternHeight;
+	default:
+		return 2 * pShape->cisternRadius;
+	}
+}
+
+// the area in square millimeters of the circular segment of the given height of a circle with the radius
+static float ICACHE_FLASH_ATTR volumetable_getSegmentArea(float pRadius, float pHeight)
+{
+	float rMinusH = pRadius - pHeight;
+	return pRadius * pRadius * acosf(rMinusH / pRadius) - rMinusH * sqrtf(2.0 * pRadius * pHeight - pHeight * pHeight);
+}
+
+// the water content in cubic millimeters at the water level in millimeters; the closed form of the cistern type
+static float ICACHE_FLASH_ATTR volumetable_getCubicMillimeters(const VolumeTableShape *pShape, float pLevel)
+{
+	float radius = (float)pShape->cisternRadius;
+	float levelRadius;
+
+	switch (pShape->cisternType)
+	{
+		// horizontal cylinder; the area of the circular segment times the length
+	case 1:
+		return volumetable_getSegmentArea(radius, pLevel) * pShape->cisternLength;
+
+		// sphere; the spherical cap
+	case 4:
+		return M_PI * pLevel * pLevel * (3.0 * radius - pLevel) / 3.0;
+
+		// rectangular cistern
+	case 5:
+		return (float)pShape->cisternLength * (float)pShape->cisternWidth * pLevel;
+
+		// vertical truncated cone; the frustum from the bottom to the water level
+	case 6:
+		levelRadius = radius + ((float)pShape->cisternTopRadius - radius) * pLevel / (float)pShape->cisternHeight;
+		return M_PI * pLevel * (radius * radius + radius * levelRadius + levelRadius * levelRadius) / 3.0;
+
+		// horizontal cylinder with ellipsoidal ends; both ends together are a spheroid with the semi-axes radius, radius and dome depth
+	case 7:
+		return volumetable_getSegmentArea(radius, pLevel) * pShape->cisternLength +
+			M_PI * pLevel * pLevel * (3.0 * radius - pLevel) / 3.0 * (float)pShape->cisternDomeDepth / radius;
+
+	default:
+		return 0;
+	}
+}
+
+// builds the volume tables of all tabulated cisterns of the configuration into RAM
+void ICACHE_FLASH_ATTR volumetable_build()
+{
+	VolumeTableShape shape;
+
+	for (int i = 0; i < ULTRASONIC_CHANNEL_COUNT; i++)
+	{
+		unsigned char isTabulated = volumetable_getShape(i, &shape);
+		uint32 height = volumetable_getHeight(&shape);
+		volumetable_heights[i] = height * DISTANCE_UNITS_PER_MM;
+		volumetable_isChannelValid[i] = isTabulated == TRUE && volumetable_heights[i] > 0;
+		if (volumetable_isChannelValid[i] == FALSE)
+		{
+			continue;
+		}
+		// level * scale stays below 2^32 up to the full height
+		volumetable_scales[i] = (((uint32)VOLUME_TABLE_SEGMENTS << VOLUME_TABLE_SCALE_BITS) + volumetable_heights[i] / 2) / volumetable_heights[i];
+		for (int p = 0; p < VOLUME_TABLE_POINTS; p++)
+		{
+			volumetable_milliliters[i][p] = (uint32)(volumetable_getCubicMillimeters(&shape, (float)height * p / VOLUME_TABLE_SEGMENTS) / 1000.0 + 0.5);
+		}
+	}
+	volumetable_isBuilt = TRUE;
+}
+
+// gets the water content of the cistern of the channel in milliliters by linear interpolation of the table
+unsigned char ICACHE_FLASH_ATTR volumetable_getMilliliters(unsigned char pChannel, sint32 pWaterLevel, uint32 *pMilliliters)
+{
+	if (volumetable_isBuilt == FALSE)
+	{
+		volumetable_build();
+	}
+	if (volumetable_isChannelValid[pChannel] == FALSE)
+	{
+		return FALSE;
+	}
+
+	// the position of the water level in the table in segments with VOLUME_TABLE_SCALE_BITS fraction bits
+	uint32 height = volumetable_heights[pChannel];
+	uint32 level = pWaterLevel < 0 ? 0 : ((uint32)pWaterLevel > height ? height : (uint32)pWaterLevel);
+	uint32 position = level * volumetable_scales[pChannel];
+	uint32 segment = position >> VOLUME_TABLE_SCALE_BITS;
+	// the full cistern is the last point
+	if (segment >= VOLUME_TABLE_SEGMENTS)
+	{
+		*pMilliliters = volumetable_milliliters[pChannel][VOLUME_TABLE_SEGMENTS];
+		return TRUE;
+	}
+	// the fraction is kept to 16 bits; the difference is split into 16-bit halves so that no product overflows 32 bits
+	// the content increases with the level; so the difference is never negative
+	uint32 fraction = (position >> (VOLUME_TABLE_SCALE_BITS - 16)) & 0xFFFF;
+	uint32 *points = &volumetable_milliliters[pChannel][segment];
+	uint32 difference = points[1] - points[0];
+	*pMilliliters = points[0] + (difference >> 16) * fraction + (((difference & 0xFFFF) * fraction) >> 16);
+	return TRUE;
+}
\ No newline at end of file